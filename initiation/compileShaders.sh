@@ -3,4 +3,6 @@
 temp="$(dirname "$0")"
 
 $VULKAN_SDK/bin/glslangValidator -V $temp/resources/shaders/shader.vert -o $temp/resources/shaders/build/vert.spv
-$VULKAN_SDK/bin/glslangValidator -V $temp/resources/shaders/shader.frag -o $temp/resources/shaders/build/frag.spv
\ No newline at end of file
+$VULKAN_SDK/bin/glslangValidator -V $temp/resources/shaders/shader.frag -o $temp/resources/shaders/build/frag.spv
+$VULKAN_SDK/bin/glslangValidator -V $temp/resources/shaders/indirect.vert -o $temp/resources/shaders/build/indirect_vert.spv
+$VULKAN_SDK/bin/glslangValidator -V $temp/resources/shaders/indirect.frag -o $temp/resources/shaders/build/indirect_frag.spv
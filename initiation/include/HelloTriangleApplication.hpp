@@ -48,7 +48,7 @@ class HelloTriangleApplication {
 
         MeshManager mMeshManager;
         std::unique_ptr<Mesh> mTemp;
-        std::vector<std::unique_ptr<Mesh>> mMeshes;
+        std::vector<std::unique_ptr<MeshInstance>> mInstances;
 
         Importer mImporter;
         Mesh mDeer;
@@ -1,7 +1,10 @@
 #ifndef __BINARY_TREE_HPP__
 #define __BINARY_TREE_HPP__
 
-#include <memory>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
 
 /**
  * \file BinaryTree.hpp
@@ -10,47 +13,88 @@
  * \date 15/02/2019
  */
 
+/**
+ * Binary tree whose nodes live in a single arena and refer to each other by
+ * index, so that building it never allocates per node and moving it is O(1).
+ * Removed nodes are recycled by the next insertions.
+ *
+ * The tree is move-only. Grafting a subtree moves its values into this arena.
+ * Node and leaf counts are kept up to date, the depth is computed without
+ * recursion. The traversals share a scratch stack, so even const methods must
+ * not be called concurrently.
+ */
 template <typename T>
 class BinaryTree {
     public:
+        using NodeIndex = uint32_t;
+        static constexpr NodeIndex InvalidIndex{0xFFFFFFFF};
+
         BinaryTree(T value);
-        BinaryTree(const BinaryTree& other);
-        BinaryTree(BinaryTree&& other);
-        BinaryTree& operator=(const BinaryTree& other);
-        BinaryTree& operator=(BinaryTree&& other);
+        BinaryTree(const BinaryTree& other) = delete;
+        BinaryTree(BinaryTree&& other) noexcept;
+        BinaryTree& operator=(const BinaryTree& other) = delete;
+        BinaryTree& operator=(BinaryTree&& other) noexcept;
 
-        void setLeft(const BinaryTree& left);
-        void setLeft(BinaryTree&& left);
-        void setRight(const BinaryTree& right);
-        void setRight(BinaryTree&& right);
+        NodeIndex setLeft(NodeIndex node, T value);
+        NodeIndex setLeft(NodeIndex node, BinaryTree&& left);
+        NodeIndex setRight(NodeIndex node, T value);
+        NodeIndex setRight(NodeIndex node, BinaryTree&& right);
 
-        void removeLeft();
-        void removeRight();
+        void removeLeft(NodeIndex node);
+        void removeRight(NodeIndex node);
 
-        BinaryTree& getLeft();
-        const BinaryTree& getLeft() const;
-        BinaryTree& getRight();
-        const BinaryTree& getRight() const;
+        NodeIndex getRoot() const;
+        NodeIndex getLeft(NodeIndex node) const;
+        NodeIndex getRight(NodeIndex node) const;
+        NodeIndex getParent(NodeIndex node) const;
 
-        bool hasLeft() const;
-        bool hasRight() const;
+        bool hasLeft(NodeIndex node) const;
+        bool hasRight(NodeIndex node) const;
+        bool isLeaf(NodeIndex node) const;
+        bool isEmpty() const;
 
         size_t getDepth() const;
+        size_t getDepth(NodeIndex node) const;
         size_t getLeafCount() const;
         size_t getNodeCount() const;
 
-        T& getValue();
-        const T& getValue() const;
-        bool isLeaf() const;
+        T& getValue(NodeIndex node);
+        const T& getValue(NodeIndex node) const;
+
+        void reserve(size_t nodeCount);
 
     private:
-        T mValue;
+        struct Node {
+            T value;
+            NodeIndex parent;
+            NodeIndex left{InvalidIndex};
+            NodeIndex right{InvalidIndex};
+            uint32_t level;                 /* Distance to the root, InvalidIndex once released */
+        };
+
+        struct Visit {
+            NodeIndex node;
+            NodeIndex parent;               /* Grafting only, the copy of the parent in this tree */
+            bool left;
+        };
+
+        std::vector<Node> mNodes;
+        std::vector<NodeIndex> mUnusedNodes;
+        mutable std::vector<Visit> mVisits;
+
+        NodeIndex mRoot{InvalidIndex};
+        size_t mNodeCount{0};
+        size_t mLeafCount{0};
+
+        NodeIndex attach(NodeIndex node, bool left, T&& value);
+        NodeIndex graft(NodeIndex node, bool left, BinaryTree&& subtree);
+        void remove(NodeIndex node, bool left);
 
-        bool mIsLeaf;
-        std::unique_ptr<BinaryTree> mLeft;
-        std::unique_ptr<BinaryTree> mRight;
+        NodeIndex createNode(T&& value, NodeIndex parent, uint32_t level);
+        NodeIndex& getChild(NodeIndex node, bool left);
+        void checkNode(NodeIndex node) const;
 };
 
 #include "BinaryTree.tpp"
 
-#endif
\ No newline at end of file
+#endif
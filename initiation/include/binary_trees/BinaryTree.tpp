@@ -1,187 +1,285 @@
 template <typename T>
-BinaryTree<T>::BinaryTree(T value) : mValue(value), mLeft(nullptr), mRight(nullptr), mIsLeaf(true) {}
-
-template <typename T>
-BinaryTree<T>::BinaryTree(const BinaryTree<T>& other) : mIsLeaf(other.mIsLeaf), mValue(other.mValue) {
-    BinaryTree* otherLeft{other.mLeft.get()};
-    BinaryTree* otherRight{other.mRight.get()};
-    if (otherLeft) {
-        mLeft = std::unique_ptr<BinaryTree>(new BinaryTree(*otherLeft));
-    } else {
-        mLeft = std::unique_ptr<BinaryTree>(nullptr);
-    }
-    if (otherRight) {
-        mRight = std::unique_ptr<BinaryTree>(new BinaryTree(*otherRight));
-    } else {
-        mRight = std::unique_ptr<BinaryTree>(nullptr);
-    }
+BinaryTree<T>::BinaryTree(T value) {
+    mRoot = createNode(std::move(value), InvalidIndex, 0);
+    mLeafCount = 1;
 }
 
 template <typename T>
-BinaryTree<T>::BinaryTree(BinaryTree<T>&& other) : mIsLeaf(std::move(other.mIsLeaf)), mValue(std::move(other.mValue)),
-    mLeft(std::move(other.mLeft)), mRight(std::move(other.mRight)) {
+BinaryTree<T>::BinaryTree(BinaryTree<T>&& other) noexcept : mNodes(std::move(other.mNodes)),
+    mUnusedNodes(std::move(other.mUnusedNodes)), mRoot(other.mRoot), mNodeCount(other.mNodeCount), mLeafCount(other.mLeafCount) {
+    other.mRoot = InvalidIndex;
+    other.mNodeCount = 0;
+    other.mLeafCount = 0;
 }
 
 template <typename T>
-BinaryTree<T>& BinaryTree<T>::operator=(const BinaryTree<T>& other) {
-    mIsLeaf = other.mIsLeaf;
-    mValue = other.mValue;
-    if (other.mLeft) {
-        mLeft = std::unique_ptr<BinaryTree<T>>(new BinaryTree<T>(*other.mLeft));
-    } else {
-        mLeft = std::unique_ptr<BinaryTree<T>>(nullptr);
-    }
-    if (other.mRight) {
-        mRight = std::unique_ptr<BinaryTree<T>>(new BinaryTree<T>(*other.mRight));
-    } else {
-        mRight = std::unique_ptr<BinaryTree<T>>(nullptr);
-    }
+BinaryTree<T>& BinaryTree<T>::operator=(BinaryTree<T>&& other) noexcept {
+    mNodes = std::move(other.mNodes);
+    mUnusedNodes = std::move(other.mUnusedNodes);
+    mRoot = other.mRoot;
+    mNodeCount = other.mNodeCount;
+    mLeafCount = other.mLeafCount;
+
+    other.mRoot = InvalidIndex;
+    other.mNodeCount = 0;
+    other.mLeafCount = 0;
+    return *this;
 }
 
 template <typename T>
-BinaryTree<T>& BinaryTree<T>::operator=(BinaryTree<T>&& other) {
-    mIsLeaf = std::move(other.mIsLeaf);
-    mValue = std::move(other.mValue);
-    mLeft = std::move(other.mLeft);
-    mRight = std::move(other.mRight);
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::setLeft(NodeIndex node, T value) {
+    return attach(node, true, std::move(value));
 }
 
 template <typename T>
-void BinaryTree<T>::setLeft(const BinaryTree<T>& left) {
-    mLeft = std::unique_ptr<BinaryTree<T>>(new BinaryTree<T>(left));
-    mIsLeaf = false;
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::setLeft(NodeIndex node, BinaryTree<T>&& left) {
+    return graft(node, true, std::move(left));
 }
 
 template <typename T>
-void BinaryTree<T>::setLeft(BinaryTree<T>&& left) {
-    mLeft = std::unique_ptr<BinaryTree<T>>(new BinaryTree<T>(left));
-    mIsLeaf = false;
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::setRight(NodeIndex node, T value) {
+    return attach(node, false, std::move(value));
 }
 
 template <typename T>
-void BinaryTree<T>::setRight(const BinaryTree<T>& right) {
-    mRight = std::unique_ptr<BinaryTree<T>>(new BinaryTree<T>(right));
-    mIsLeaf = false;
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::setRight(NodeIndex node, BinaryTree<T>&& right) {
+    return graft(node, false, std::move(right));
 }
 
 template <typename T>
-void BinaryTree<T>::setRight(BinaryTree<T>&& right) {
-    mRight = std::unique_ptr<BinaryTree<T>>(new BinaryTree<T>(right));
-    mIsLeaf = false;
+void BinaryTree<T>::removeLeft(NodeIndex node) {
+    remove(node, true);
 }
 
 template <typename T>
-void BinaryTree<T>::removeLeft() {
-    mLeft.reset(nullptr);
-    mIsLeaf = !(hasLeft() || hasRight());
+void BinaryTree<T>::removeRight(NodeIndex node) {
+    remove(node, false);
 }
 
 template <typename T>
-void BinaryTree<T>::removeRight() {
-    mRight.reset(nullptr);
-    mIsLeaf = !(hasLeft() || hasRight());
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::getRoot() const {
+    return mRoot;
 }
 
 template <typename T>
-BinaryTree<T>& BinaryTree<T>::getLeft() {
-    if (!hasLeft()) {
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::getLeft(NodeIndex node) const {
+    if (!hasLeft(node)) {
         throw std::runtime_error("Error ! This tree doesn't have a left subtree");
     }
-    return *mLeft;
+    return mNodes[node].left;
 }
 
 template <typename T>
-const BinaryTree<T>& BinaryTree<T>::getLeft() const {
-    if (!hasLeft()) {
-        throw std::runtime_error("Error ! This tree doesn't have a left subtree");
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::getRight(NodeIndex node) const {
+    if (!hasRight(node)) {
+        throw std::runtime_error("Error ! This tree doesn't have a right subtree");
     }
-    return *mLeft;
+    return mNodes[node].right;
 }
 
 template <typename T>
-BinaryTree<T>& BinaryTree<T>::getRight() {
-    if (!hasRight()) {
-        throw std::runtime_error("Error ! This tree doesn't have a right subtree");
-    }
-    return *mRight;
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::getParent(NodeIndex node) const {
+    checkNode(node);
+    return mNodes[node].parent;
 }
 
 template <typename T>
-const BinaryTree<T>& BinaryTree<T>::getRight() const {
-    if (!hasRight()) {
-        throw std::runtime_error("Error ! This tree doesn't have a right subtree");
-    }
-    return *mRight;
+bool BinaryTree<T>::hasLeft(NodeIndex node) const {
+    checkNode(node);
+    return mNodes[node].left != InvalidIndex;
+}
+
+template <typename T>
+bool BinaryTree<T>::hasRight(NodeIndex node) const {
+    checkNode(node);
+    return mNodes[node].right != InvalidIndex;
 }
 
 template <typename T>
-bool BinaryTree<T>::hasLeft() const {
-    return (bool)mLeft;
+bool BinaryTree<T>::isLeaf(NodeIndex node) const {
+    return !(hasLeft(node) || hasRight(node));
 }
 
 template <typename T>
-bool BinaryTree<T>::hasRight() const {
-    return (bool)mRight;
+bool BinaryTree<T>::isEmpty() const {
+    return mRoot == InvalidIndex;
 }
 
 template <typename T>
 size_t BinaryTree<T>::getDepth() const {
-    if (mIsLeaf) {
-        return 0;
-    }
+    return isEmpty() ? 0 : getDepth(mRoot);
+}
 
-    size_t mLeftDepth{0}, mRightDepth{0};
-    if (mLeft) {
-        mLeftDepth = mLeft->getDepth();
-    }
+template <typename T>
+size_t BinaryTree<T>::getDepth(NodeIndex node) const {
+    checkNode(node);
 
-    if (mRight) {
-        mRightDepth = mRight->getDepth();
+    /* Depth-first walk of the subtree, the deepest level gives the depth */
+    uint32_t deepestLevel{mNodes[node].level};
+    mVisits.clear();
+    mVisits.push_back({node, InvalidIndex, false});
+    while (!mVisits.empty()) {
+        const Node& current = mNodes[mVisits.back().node];
+        mVisits.pop_back();
+
+        deepestLevel = std::max(deepestLevel, current.level);
+        if (current.left != InvalidIndex) {
+            mVisits.push_back({current.left, InvalidIndex, true});
+        }
+        if (current.right != InvalidIndex) {
+            mVisits.push_back({current.right, InvalidIndex, false});
+        }
     }
-    return 1 + std::max(mLeftDepth, mRightDepth);
+    return deepestLevel - mNodes[node].level;
 }
 
 template <typename T>
 size_t BinaryTree<T>::getLeafCount() const {
-    if (mIsLeaf) {
-        return 1;
+    return mLeafCount;
+}
+
+template <typename T>
+size_t BinaryTree<T>::getNodeCount() const {
+    return mNodeCount;
+}
+
+template <typename T>
+T& BinaryTree<T>::getValue(NodeIndex node) {
+    checkNode(node);
+    return mNodes[node].value;
+}
+
+template <typename T>
+const T& BinaryTree<T>::getValue(NodeIndex node) const {
+    checkNode(node);
+    return mNodes[node].value;
+}
+
+template <typename T>
+void BinaryTree<T>::reserve(size_t nodeCount) {
+    mNodes.reserve(nodeCount);
+}
+
+template <typename T>
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::attach(NodeIndex node, bool left, T&& value) {
+    remove(node, left);
+
+    /* A leaf loses its leaf status to the new node, otherwise the new node adds a leaf */
+    if (!isLeaf(node)) {
+        mLeafCount++;
     }
-    size_t mLeftLeafCount{0}, mRightLeafCount{0};
-    if (mLeft) {
-        mLeftLeafCount = mLeft->getLeafCount();
+
+    NodeIndex child = createNode(std::move(value), node, mNodes[node].level + 1);
+    getChild(node, left) = child;
+    return child;
+}
+
+template <typename T>
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::graft(NodeIndex node, bool left, BinaryTree<T>&& subtree) {
+    if (&subtree == this) {
+        throw std::runtime_error("Error ! A tree can't be grafted onto itself");
     }
-    if (mRight) {
-        mRightLeafCount = mRight->getLeafCount();
+    remove(node, left);
+    if (subtree.isEmpty()) {
+        return InvalidIndex;
     }
-    return mLeftLeafCount + mRightLeafCount;
+
+    mLeafCount += subtree.mLeafCount - (isLeaf(node) ? 1 : 0);
+    reserve(mNodes.size() + subtree.mNodeCount);
+
+    /* The subtree is consumed, its scratch stack is used so that this one doesn't grow */
+    NodeIndex graftedRoot{InvalidIndex};
+    std::vector<Visit>& visits = subtree.mVisits;
+    visits.clear();
+    visits.push_back({subtree.mRoot, node, left});
+    while (!visits.empty()) {
+        Visit visit = visits.back();
+        visits.pop_back();
+
+        Node& source = subtree.mNodes[visit.node];
+        NodeIndex copy = createNode(std::move(source.value), visit.parent, mNodes[visit.parent].level + 1);
+        getChild(visit.parent, visit.left) = copy;
+        if (graftedRoot == InvalidIndex) {
+            graftedRoot = copy;
+        }
+
+        if (source.left != InvalidIndex) {
+            visits.push_back({source.left, copy, true});
+        }
+        if (source.right != InvalidIndex) {
+            visits.push_back({source.right, copy, false});
+        }
+    }
+
+    subtree.mNodes.clear();
+    subtree.mUnusedNodes.clear();
+    subtree.mRoot = InvalidIndex;
+    subtree.mNodeCount = 0;
+    subtree.mLeafCount = 0;
+    return graftedRoot;
 }
 
 template <typename T>
-size_t BinaryTree<T>::getNodeCount() const {
-    if (mIsLeaf) {
-        return 1;
+void BinaryTree<T>::remove(NodeIndex node, bool left) {
+    checkNode(node);
+    NodeIndex child = getChild(node, left);
+    if (child == InvalidIndex) {
+        return;
     }
-    size_t mLeftLeafCount{0}, mRightLeafCount{0};
-    if (mLeft) {
-        mLeftLeafCount = mLeft->getNodeCount();
+    getChild(node, left) = InvalidIndex;
+
+    /* Release the whole subtree, its slots are reused by the next insertions */
+    mVisits.clear();
+    mVisits.push_back({child, InvalidIndex, left});
+    while (!mVisits.empty()) {
+        Node& current = mNodes[mVisits.back().node];
+        NodeIndex currentIndex = mVisits.back().node;
+        mVisits.pop_back();
+
+        if (current.left == InvalidIndex && current.right == InvalidIndex) {
+            mLeafCount--;
+        }
+        if (current.left != InvalidIndex) {
+            mVisits.push_back({current.left, InvalidIndex, true});
+        }
+        if (current.right != InvalidIndex) {
+            mVisits.push_back({current.right, InvalidIndex, false});
+        }
+
+        current.level = InvalidIndex;
+        mUnusedNodes.push_back(currentIndex);
+        mNodeCount--;
     }
-    if (mRight) {
-        mRightLeafCount = mRight->getNodeCount();
+
+    if (isLeaf(node)) {
+        mLeafCount++;
     }
-    return 1 + mLeftLeafCount + mRightLeafCount;
 }
 
 template <typename T>
-T& BinaryTree<T>::getValue() {
-    return mValue;
+typename BinaryTree<T>::NodeIndex BinaryTree<T>::createNode(T&& value, NodeIndex parent, uint32_t level) {
+    NodeIndex nodeIndex;
+    if (!mUnusedNodes.empty()) {
+        nodeIndex = mUnusedNodes.back();
+        mUnusedNodes.pop_back();
+        mNodes[nodeIndex] = Node{std::move(value), parent, InvalidIndex, InvalidIndex, level};
+    } else {
+        nodeIndex = static_cast<NodeIndex>(mNodes.size());
+        mNodes.push_back(Node{std::move(value), parent, InvalidIndex, InvalidIndex, level});
+    }
+
+    mNodeCount++;
+    return nodeIndex;
 }
 
 template <typename T>
-const T& BinaryTree<T>::getValue() const {
-    return mValue;
+typename BinaryTree<T>::NodeIndex& BinaryTree<T>::getChild(NodeIndex node, bool left) {
+    return left ? mNodes[node].left : mNodes[node].right;
 }
 
 template <typename T>
-bool BinaryTree<T>::isLeaf() const {
-    return mIsLeaf;
-}
\ No newline at end of file
+void BinaryTree<T>::checkNode(NodeIndex node) const {
+    if (node >= mNodes.size() || mNodes[node].level == InvalidIndex) {
+        throw std::runtime_error("Error ! This node doesn't belong to the tree");
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef __ALLOCATION_HANDLE_HPP__
+#define __ALLOCATION_HANDLE_HPP__
+
+#include <cstdint>
+
+/**
+ * Index of an allocation record, plus the generation of the slot when it was
+ * handed out, so that a handle kept after a free is detected as stale.
+ */
+struct AllocationHandle {
+    static constexpr uint32_t InvalidIndex{0xFFFFFFFF};
+
+    uint32_t index{InvalidIndex};
+    uint32_t generation{0};
+
+    bool isValid() const {
+        return index != InvalidIndex;
+    }
+
+    bool operator==(const AllocationHandle& other) const {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const AllocationHandle& other) const {
+        return !(*this == other);
+    }
+};
+
+#endif
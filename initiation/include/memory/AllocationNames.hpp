@@ -0,0 +1,40 @@
+#ifndef __ALLOCATION_NAMES_HPP__
+#define __ALLOCATION_NAMES_HPP__
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+struct NamedUsage {
+    std::string name;
+    VkDeviceSize liveBytes{0};
+    VkDeviceSize peakBytes{0};
+    uint32_t liveCount{0};
+    uint32_t totalCount{0};     /* Allocations made under this name since startup */
+};
+
+/**
+ * Interned allocation names, with the memory currently and at most held under
+ * each of them. A name is stored once, allocations only keep its index.
+ *
+ * Not thread safe, the memory manager calls it under its resource info lock.
+ */
+class AllocationNames {
+    public:
+        uint32_t intern(const std::string& name);
+        const std::string& getName(uint32_t nameId) const;
+
+        void add(uint32_t nameId, VkDeviceSize size);
+        void remove(uint32_t nameId, VkDeviceSize size);
+
+        const std::vector<NamedUsage>& getUsages() const;
+
+    private:
+        std::unordered_map<std::string, uint32_t> mIds;
+        std::vector<NamedUsage> mUsages;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef __ALLOCATION_PROFILE_HPP__
+#define __ALLOCATION_PROFILE_HPP__
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/Chunk.hpp"
+#include "memory/SlabAllocator.hpp"
+
+struct ProfiledChunk {
+    VkDeviceSize size;
+    ResourceTiling tiling;
+};
+
+struct MemoryTypeProfile {
+    VkMemoryPropertyFlags flags{0};
+    VkDeviceSize peakReservedBytes{0};                              /* Pooled chunks only, dedicated ones are per resource */
+    std::vector<ProfiledChunk> chunks;                              /* The pooled chunks when the peak was reached */
+    std::array<uint32_t, SlabAllocator::SizeClassCount> slabCounts{};  /* Peak slab count of each size class */
+};
+
+/**
+ * Peak chunk usage of every memory type, recorded during a run and replayed at
+ * the next startup so that steady-state frames never reach vkAllocateMemory.
+ *
+ * Stored as text, one line per memory type:
+ * type <index> <flags> chunks <count> (<size> <linear|optimal>)... slabs <count per size class>...
+ */
+struct AllocationProfile {
+    std::array<MemoryTypeProfile, VK_MAX_MEMORY_TYPES> types;
+
+    bool load(const std::string& filename);
+    void save(const std::string& filename, uint32_t memoryTypeCount) const;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef __ALLOCATION_TABLE_HPP__
+#define __ALLOCATION_TABLE_HPP__
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <chrono>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/AllocationHandle.hpp"
+#include "memory/BufferInfo.hpp"
+#include "memory/MovableResource.hpp"
+
+struct AllocationRecord {
+    BufferInfo info;
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    void* mappedPointer{nullptr};
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VkImage image{VK_NULL_HANDLE};
+    std::shared_ptr<MovableResource> movable;       /* Set when the defragmenter may relocate it */
+
+    uint32_t nameId{0};
+    VkDeviceSize size{0};                           /* What the resource asked for */
+    uint64_t frame{0};                              /* Frame during which it was allocated */
+    std::chrono::steady_clock::time_point time;
+};
+
+/**
+ * Generational slot array of allocation records.
+ *
+ * Records live contiguously and are reached in O(1) from their handle. A freed
+ * slot is reused by the next insertion with its generation bumped, so the
+ * handles still pointing to it are rejected.
+ */
+class AllocationTable {
+    public:
+        AllocationHandle insert(const AllocationRecord& record);
+        void erase(AllocationHandle handle);
+        bool contains(AllocationHandle handle) const;
+        AllocationRecord& get(AllocationHandle handle);
+        const AllocationRecord& get(AllocationHandle handle) const;
+        size_t size() const;
+        void clear();
+
+        template<typename Function>
+        void forEach(Function function) {
+            for (uint32_t i{0};i < mSlots.size();++i) {
+                if (mSlots[i].used) {
+                    function(AllocationHandle{i, mSlots[i].generation}, mSlots[i].record);
+                }
+            }
+        }
+
+    private:
+        struct Slot {
+            AllocationRecord record;
+            uint32_t generation{0};
+            bool used{false};
+        };
+
+        std::vector<Slot> mSlots;
+        std::vector<uint32_t> mFreeSlots;
+        size_t mSize{0};
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef __ALLOCATION_TRACE_HPP__
+#define __ALLOCATION_TRACE_HPP__
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/Chunk.hpp"
+#include "memory/AllocationHandle.hpp"
+
+enum class TraceEventType { Allocation, Free, Frame };
+
+struct TraceEvent {
+    TraceEventType type;
+    uint64_t id{0};                     /* Allocation and free, matches a free with its allocation */
+    VkDeviceSize size{0};
+    VkDeviceSize alignment{1};
+    VkMemoryPropertyFlags flags{0};     /* Flags of the memory type the allocation ended up in */
+    bool image{false};
+    ResourceTiling tiling{ResourceTiling::Linear};
+    uint32_t imageIndex{0};             /* Frame only */
+};
+
+/**
+ * Every allocation, free and frame boundary of a run, so that the allocator
+ * can later be replayed and measured against the same workload without a GPU.
+ *
+ * Stored as text, one event per line:
+ * alloc <id> <size> <alignment> <flags> <buffer|image> <linear|optimal>
+ * free <id>
+ * frame <image index>
+ */
+class AllocationTrace {
+    public:
+        bool open(const std::string& filename);
+        bool isOpen() const;
+        void close();
+
+        void recordAllocation(AllocationHandle handle, const VkMemoryRequirements& memoryRequirements,
+                              VkMemoryPropertyFlags flags, bool image, ResourceTiling tiling);
+        void recordFree(AllocationHandle handle);
+        void recordFrame(uint32_t imageIndex);
+
+        static bool load(const std::string& filename, std::vector<TraceEvent>& events);
+
+    private:
+        std::ofstream mFile;
+        std::mutex mMutex;
+
+        static uint64_t getId(AllocationHandle handle);
+};
+
+#endif
@@ -8,6 +8,7 @@ struct Block {
     Block(const size_t blockSize = 0, const size_t blockOffset = 0);
     size_t size;
     size_t offset;
+    size_t requestedSize{0};
     bool free{true};
     bool full{false};
 
@@ -18,4 +19,9 @@ struct Block {
 
 bool operator==(const Block& b1, const Block& b2);
 
+struct AllocationResult {
+    bool found;
+    Block block;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef __BUDDY_CHUNK_HPP__
+#define __BUDDY_CHUNK_HPP__
+
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/Chunk.hpp"
+
+/**
+ * Buddy allocator over a single VkDeviceMemory.
+ *
+ * Blocks of order o have a size of (leaf size << o). Each order owns a bitmap
+ * of its free blocks and an intrusive free list whose links are stored in
+ * arrays indexed by the block offset in leaf units. Reserving and freeing are
+ * O(log n) and never allocate once the chunk is constructed.
+ */
+class BuddyChunk : public Chunk {
+    public:
+        BuddyChunk(VkDeviceMemory memory, const size_t chunkSize, const size_t minBlockSize = MinBlockSize);
+        AllocationResult reserve(const size_t blockSize, const size_t alignment = 1) override;
+        bool free(Block block) override;
+        AllocationStrategy getStrategy() const override;
+        void getFreeBlocks(std::vector<Block>& freeBlocks) const override;
+
+        void setMinBlockSize(const size_t minBlockSize);
+
+        static size_t MinBlockSize;
+
+    private:
+        static constexpr uint32_t InvalidIndex{0xFFFFFFFF};
+
+        size_t mMinBlockSize;
+        size_t mLeafSize;
+        uint32_t mOrderCount;
+
+        std::vector<uint32_t> mFreeListHeads;
+        std::vector<uint32_t> mNext;
+        std::vector<uint32_t> mPrevious;
+        std::vector<size_t> mBitOffsets;
+        std::vector<uint64_t> mFreeBits;
+        std::vector<uint64_t> mAllocatedBits;
+
+        void build(const size_t leafSize);
+
+        uint32_t getOrder(const size_t blockSize) const;
+        size_t getBitIndex(const uint32_t order, const uint32_t leafIndex) const;
+
+        void pushFree(const uint32_t order, const uint32_t leafIndex);
+        uint32_t popFree(const uint32_t order);
+        void removeFree(const uint32_t order, const uint32_t leafIndex);
+
+        static bool testBit(const std::vector<uint64_t>& bits, const size_t index);
+        static void setBit(std::vector<uint64_t>& bits, const size_t index);
+        static void clearBit(std::vector<uint64_t>& bits, const size_t index);
+};
+
+#endif
@@ -9,6 +9,8 @@ struct BufferInfo {
     Block block;
     uint32_t chunkIndex;
     uint32_t memoryTypeIndex;
+    bool cached{false};
+    bool slab{false};
 };
 
 #endif
\ No newline at end of file
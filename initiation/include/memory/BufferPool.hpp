@@ -0,0 +1,86 @@
+#ifndef __BUFFER_POOL_HPP__
+#define __BUFFER_POOL_HPP__
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/Block.hpp"
+#include "memory/AllocationHandle.hpp"
+#include "memory/MemoryUsage.hpp"
+#include "memory/MovableResource.hpp"
+#include "memory/TlsfAllocator.hpp"
+
+class MemoryManager;
+
+enum class BufferClass { Geometry, Staging };
+
+struct BufferRange {
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VkDeviceSize offset{0};
+    VkDeviceSize size{0};
+    void* data{nullptr};
+
+    uint32_t blockIndex{0};
+    Block block;
+};
+
+/**
+ * Sub-allocates ranges of a few large VkBuffers sharing the same usage.
+ *
+ * Each pool block is one VkBuffer bound once to its memory, and its ranges
+ * are managed by a TLSF allocator working on offsets only. Allocating a range
+ * therefore never creates a buffer nor binds memory, except when every block
+ * is full. Ranges bigger than a block get a block of their own.
+ *
+ * Once an owner listens for moves, the blocks of a device local pool can be
+ * relocated by the defragmenter. The ranges keep their block and offset, only
+ * the buffer they hold has to be replaced.
+ */
+class BufferPool {
+    public:
+        BufferPool(VkDevice& device, MemoryManager& memoryManager);
+
+        void create(VkBufferUsageFlags usage, MemoryUsage memoryUsage, VkDeviceSize alignment,
+                    const std::vector<uint32_t>& queueFamilyIndices = {}, VkDeviceSize blockSize = DefaultBlockSize);
+        void destroy();
+
+        BufferRange allocate(VkDeviceSize size);
+        void free(const BufferRange& range);
+        void setMoveCallback(BufferMoveCallback onMove);
+
+        static VkDeviceSize DefaultBlockSize;
+
+    private:
+        struct PoolBlock {
+            VkBuffer buffer{VK_NULL_HANDLE};
+            AllocationHandle allocation;
+            std::unique_ptr<TlsfAllocator> ranges;
+            uint8_t* data{nullptr};
+        };
+
+        VkDevice& mDevice;
+        MemoryManager& mMemoryManager;
+
+        VkBufferUsageFlags mUsage{0};
+        MemoryUsage mMemoryUsage{MemoryUsage::GpuOnly};
+        VkDeviceSize mAlignment{1};
+        VkDeviceSize mBlockSize{0};
+        std::vector<uint32_t> mQueueFamilyIndices;      /* Concurrent sharing when several families use the ranges */
+
+        std::vector<PoolBlock> mBlocks;
+        std::mutex mMutex;
+        BufferMoveCallback mMoveCallback;
+
+        uint32_t createBlock(VkDeviceSize size);
+        void destroyBlock(PoolBlock& block);
+        void release(const BufferRange& range);
+        VkBufferCreateInfo getCreateInfo(VkDeviceSize size) const;
+        void setBlockMovable(uint32_t blockIndex);
+        void moveBlock(uint32_t blockIndex, VkBuffer oldBuffer, VkBuffer newBuffer);
+};
+
+#endif
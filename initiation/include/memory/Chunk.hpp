@@ -1,38 +1,54 @@
 #ifndef __CHUNK_HPP__
 #define __CHUNK_HPP__
 
+#include <cstdint>
+#include <vector>
+
 #include <vulkan/vulkan.h>
 
 #include "memory/Block.hpp"
-#include "binary_trees/BinaryTree.hpp"
 
-struct AllocationResult {
-    bool found;
-    Block block;
-};
+enum class AllocationStrategy { Buddy, Tlsf, Dedicated };
 
-using BlockBinaryTree = BinaryTree<Block>;
+/* Linear resources (buffers, linear images) and optimal images must not share a bufferImageGranularity page */
+enum class ResourceTiling { Linear, Optimal };
 
+/**
+ * A single VkDeviceMemory allocation sub-allocated by one strategy.
+ */
 class Chunk {
     public:
-        Chunk(VkDeviceMemory memory, const size_t chunkSize, const size_t minBlockSize = MinBlockSize);
-        AllocationResult reserve(const size_t blockSize);
-        bool free(Block block);
+        Chunk(VkDeviceMemory memory, const size_t chunkSize);
+        virtual ~Chunk() = default;
+
+        virtual AllocationResult reserve(const size_t blockSize, const size_t alignment = 1) = 0;
+        virtual bool free(Block block) = 0;
+        virtual AllocationStrategy getStrategy() const = 0;
+        virtual void getFreeBlocks(std::vector<Block>& freeBlocks) const = 0;
 
         const VkDeviceMemory getMemory() const;
-        BlockBinaryTree& getTree();
+        size_t getSize() const;
+        size_t getUsedSize() const;
+        size_t getRequestedSize() const;
+        size_t getInternalFragmentation() const;
 
-        void setMinBlockSize(const size_t minBlockSize);
+        void setMappedPointer(void* mappedPointer);
+        void* getMappedPointer() const;
 
-        static size_t MinBlockSize;
+        void setTiling(ResourceTiling tiling);
+        ResourceTiling getTiling() const;
 
-    private:
-        BlockBinaryTree mTree;
-        size_t mMinBlockSize;
-        VkDeviceMemory mMemory;
+        void setPrewarmed(bool prewarmed);
+        bool isPrewarmed() const;
 
-        static AllocationResult _reserve(const size_t blockSize, BlockBinaryTree& memory);
-        static bool _free(Block block, BlockBinaryTree& memory);
+    protected:
+        VkDeviceMemory mMemory;
+        size_t mSize;
+        size_t mUsedSize{0};
+        size_t mRequestedSize{0};
+        void* mMappedPointer{nullptr};
+        ResourceTiling mTiling{ResourceTiling::Linear};
+        bool mPrewarmed{false};     /* Allocated from the profile, kept until cleanup even while empty */
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,22 @@
+#ifndef __DEDICATED_CHUNK_HPP__
+#define __DEDICATED_CHUNK_HPP__
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/Chunk.hpp"
+
+/**
+ * A VkDeviceMemory owned by a single resource, it holds exactly one block.
+ */
+class DedicatedChunk : public Chunk {
+    public:
+        DedicatedChunk(VkDeviceMemory memory, const size_t chunkSize);
+        AllocationResult reserve(const size_t blockSize, const size_t alignment = 1) override;
+        bool free(Block block) override;
+        AllocationStrategy getStrategy() const override;
+        void getFreeBlocks(std::vector<Block>& freeBlocks) const override;
+};
+
+#endif
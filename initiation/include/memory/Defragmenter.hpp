@@ -0,0 +1,78 @@
+#ifndef __DEFRAGMENTER_HPP__
+#define __DEFRAGMENTER_HPP__
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/AllocationHandle.hpp"
+#include "memory/BufferInfo.hpp"
+#include "memory/MovableResource.hpp"
+
+class VulkanContext;
+class MemoryManager;
+
+/**
+ * Incremental compaction of the MemoryManager chunks.
+ *
+ * Each update, within a time and byte budget, the movable resources of the
+ * most sparsely used chunk are recreated in the other chunks of the same
+ * memory type and copied with the transfer queue. Their allocation records
+ * are updated in place, so the handles held by the owners stay valid, and the
+ * owners switch to the new buffers and images right away. The frame waits for
+ * the returned semaphore before reading them. The previous resources are
+ * released once the current frame has completed, which frees the emptied
+ * chunk to the driver.
+ *
+ * Only resources registered with MemoryManager::setBufferMovable or
+ * setImageMovable are moved, a chunk holding anything else (slabs, static
+ * buffers, attachments) is never evacuated.
+ */
+class Defragmenter {
+    public:
+        void create(VulkanContext& context);
+        void destroy();
+
+        VkSemaphore update();
+
+        void setTimeBudget(double milliseconds);
+        void setMaximumBytesPerUpdate(VkDeviceSize bytes);
+
+        static double DefaultTimeBudget;
+        static VkDeviceSize DefaultMaximumBytesPerUpdate;
+        static float SparseChunkThreshold;
+
+    private:
+        /* A resource recreated and bound to its new block, its record still points to the source */
+        struct Move {
+            AllocationHandle allocation;
+            std::shared_ptr<MovableResource> movable;
+            BufferInfo info;
+            VkBuffer sourceBuffer{VK_NULL_HANDLE};
+            VkImage sourceImage{VK_NULL_HANDLE};
+            VkBuffer buffer{VK_NULL_HANDLE};
+            VkImage image{VK_NULL_HANDLE};
+        };
+
+        VulkanContext* mContext;
+        MemoryManager* mMemoryManager;
+
+        double mTimeBudget{DefaultTimeBudget};
+        VkDeviceSize mMaximumBytesPerUpdate{DefaultMaximumBytesPerUpdate};
+
+        VkFence mTransferFence{VK_NULL_HANDLE};
+        VkSemaphore mTransferSemaphore{VK_NULL_HANDLE};
+        VkCommandBuffer mCommandBuffer{VK_NULL_HANDLE};
+
+        bool selectChunk(uint32_t& memoryTypeIndex, uint32_t& chunkIndex);
+        VkDeviceSize evacuate(uint32_t memoryTypeIndex, uint32_t chunkIndex);
+        bool reserve(AllocationHandle handle, uint32_t memoryTypeIndex, uint32_t chunkIndex, Move& move);
+        void recordCopies(const std::vector<Move>& moves);
+        void submit();
+        void complete(const Move& move);
+        void cancel(const Move& move);
+};
+
+#endif
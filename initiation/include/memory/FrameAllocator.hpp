@@ -0,0 +1,57 @@
+#ifndef __FRAME_ALLOCATOR_HPP__
+#define __FRAME_ALLOCATOR_HPP__
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/AllocationHandle.hpp"
+
+class MemoryManager;
+
+struct FrameAllocation {
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    void* data;
+};
+
+/**
+ * Linear allocator for data that only lives for one frame.
+ *
+ * A single persistently mapped buffer is split into one region per frame in
+ * flight. Allocations bump a pointer inside the current region, and the whole
+ * region is reclaimed at once by beginFrame(), which must only be called once
+ * the fence of the frame that previously used it has signaled.
+ */
+class FrameAllocator {
+    public:
+        FrameAllocator(VkDevice& device, MemoryManager& memoryManager);
+
+        void create(uint32_t frameCount, VkDeviceSize regionSize, VkDeviceSize alignment);
+        void destroy();
+
+        void beginFrame(uint32_t frameIndex);
+        FrameAllocation allocate(VkDeviceSize size);
+
+        VkBuffer getBuffer() const;
+        VkDeviceSize getAlignment() const;
+        bool isCreated() const;
+
+        static VkDeviceSize DefaultRegionSize;
+
+    private:
+        VkDevice& mDevice;
+        MemoryManager& mMemoryManager;
+
+        VkBuffer mBuffer{VK_NULL_HANDLE};
+        AllocationHandle mAllocation;
+        uint8_t* mData{nullptr};
+        uint32_t mFrameCount{0};
+        VkDeviceSize mRegionSize{0};
+        VkDeviceSize mAlignment{1};
+
+        VkDeviceSize mRegionEnd{0};
+        VkDeviceSize mOffset{0};
+};
+
+#endif
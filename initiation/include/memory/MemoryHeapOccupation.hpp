@@ -1,13 +0,0 @@
-#ifndef MEMORYHEAPOCCUPATION
-#define MEMORYHEAPOCCUPATION
-
-#include <vector>
-
-#include "MemoryBlock.hpp"
-
-struct MemoryHeapOccupation {
-    MemoryHeapOccupation(size_t pageCount) : blocks(pageCount) {}
-    std::vector<MemoryBlock> blocks;
-};
-
-#endif
\ No newline at end of file
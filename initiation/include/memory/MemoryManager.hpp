@@ -4,15 +4,39 @@
 #include <vector>
 #include <map>
 #include <tuple>
+#include <memory>
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <atomic>
+#include <string>
+#include <functional>
 
 #include <vulkan/vulkan.h>
 
-#include "MemoryBlock.hpp"
-#include "MemoryHeapOccupation.hpp"
 #include "BufferInfo.hpp"
 
 #include "memory/Chunk.hpp"
+#include "memory/FrameAllocator.hpp"
+#include "memory/BufferPool.hpp"
+#include "memory/MovableResource.hpp"
+#include "memory/ThreadCache.hpp"
+#include "memory/SlabAllocator.hpp"
+#include "memory/AllocationProfile.hpp"
+#include "memory/AllocationTrace.hpp"
+#include "memory/AllocationTable.hpp"
+#include "memory/AllocationNames.hpp"
+#include "memory/MemoryStatistics.hpp"
+#include "memory/MemoryUsage.hpp"
 
+/**
+ * Allocation and free can be called from any thread. Each memory type has its
+ * own lock, and small blocks are served from a per-thread cache refilled in
+ * batches. Locks are always taken in this order: thread cache, memory type,
+ * resource info. The resource info lock is never held while taking another one.
+ */
 class MemoryManager {
     public:
         MemoryManager() = delete;
@@ -24,34 +48,154 @@ class MemoryManager {
         void printInfo();
         void cleanup();
 
-        void allocateForBuffer(VkBuffer buffer,
-                               VkMemoryRequirements& memoryRequirements,
-                               VkMemoryPropertyFlags properties,
-                               std::string name);
-        void allocateForImage(VkImage image,
-                              VkMemoryRequirements& memoryRequirements,
-                              VkMemoryPropertyFlags properties,
-                              std::string name);
-        void freeBuffer(VkBuffer buffer);
-        void freeImage(VkImage image);
-        void mapMemory(VkBuffer buffer, VkDeviceSize size, void** data);
-        void unmapMemory(VkBuffer buffer);
+        AllocationHandle allocateForBuffer(VkBuffer buffer,
+                                           VkMemoryRequirements& memoryRequirements,
+                                           VkMemoryPropertyFlags properties,
+                                           const std::string& name);
+        AllocationHandle allocateForImage(VkImage image,
+                                          VkMemoryRequirements& memoryRequirements,
+                                          VkMemoryPropertyFlags properties,
+                                          const std::string& name,
+                                          VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
+        AllocationHandle allocateForBuffer(VkBuffer buffer,
+                                           VkMemoryRequirements& memoryRequirements,
+                                           MemoryUsage usage,
+                                           const std::string& name);
+        AllocationHandle allocateForImage(VkImage image,
+                                          VkMemoryRequirements& memoryRequirements,
+                                          MemoryUsage usage,
+                                          const std::string& name,
+                                          VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
+        void freeAllocation(AllocationHandle handle);
+        void releaseDeferred(std::function<void()> release);
+        void beginFrame(uint32_t imageIndex);
+        void flushDeferredReleases();
+        void* getMappedPointer(AllocationHandle handle);
+        uint32_t getHeapIndex(AllocationHandle handle);
+        uint32_t getPreferredHeapIndex(uint32_t memoryTypeBits, MemoryUsage usage) const;
+        VkDeviceSize getAllocationSize(AllocationHandle handle);
+        MemoryHeapBudget getHeapBudget(uint32_t heapIndex);
+        void setHeapBudget(uint32_t heapIndex, VkDeviceSize budget);
+
+        void createFrameAllocator(uint32_t frameCount, VkDeviceSize regionSize = FrameAllocator::DefaultRegionSize);
+        FrameAllocator& getFrameAllocator();
+        BufferPool& getBufferPool(BufferClass bufferClass);
 
         void memoryCheckLog();
+        void printAllocationReport();
+        MemoryStatistics queryStatistics();
+        void exportOccupancy(const std::string& filename);
+
+        void setAllocationStrategy(uint32_t memoryTypeIndex, AllocationStrategy strategy);
+        AllocationStrategy getAllocationStrategy(uint32_t memoryTypeIndex) const;
+        size_t getInternalFragmentation(uint32_t memoryTypeIndex) const;
+
+        void setDedicatedAllocationSupport(bool supported);
+        void setMemoryBudgetSupport(PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2);
+        void setAllocationProfile(std::string filename);
+        void setAllocationTrace(std::string filename);
+        void setSharedQueueFamilies(std::vector<uint32_t> queueFamilyIndices);
+
+        void setBufferMovable(AllocationHandle handle, const VkBufferCreateInfo& createInfo, BufferMoveCallback onMove);
+        void setImageMovable(AllocationHandle handle, const VkImageCreateInfo& createInfo, VkImageLayout layout,
+                             ImageMoveCallback onMove);
+
+        void flushThreadCaches();
 
     private:
         VkDevice& mDevice;
         VkPhysicalDevice& mPhysicalDevice;
         VkPhysicalDeviceMemoryProperties mMemoryProperties;
-        static uint32_t allocationSize;
+        static uint32_t minimumAllocationSize;
+        static uint32_t maximumAllocationSize;
         static uint32_t pageSize;
+        static float defaultBudgetRatio;
+        bool mSeparateTilings{false};
+
+        bool mDedicatedAllocationSupported{false};
+        PFN_vkGetBufferMemoryRequirements2KHR mGetBufferMemoryRequirements2{nullptr};
+        PFN_vkGetImageMemoryRequirements2KHR mGetImageMemoryRequirements2{nullptr};
+        PFN_vkGetPhysicalDeviceMemoryProperties2KHR mGetMemoryProperties2{nullptr};
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> mHeapBudgets{};
+        std::vector<uint32_t> mSharedQueueFamilies;
+
+        std::map<uint32_t, std::vector<std::unique_ptr<Chunk>>> mChunksMap;
+        std::map<uint32_t, AllocationStrategy> mStrategies;
+        std::array<SlabAllocator, VK_MAX_MEMORY_TYPES> mSlabAllocators;
+        std::string mProfileFilename;
+        AllocationProfile mRecordedProfile;
+        AllocationTrace mTrace;
+        AllocationTable mAllocations;
+        AllocationNames mNames;
+
+        FrameAllocator mFrameAllocator;
+        BufferPool mGeometryPool;
+        BufferPool mStagingPool;
+
+        struct DeferredRelease {
+            uint64_t frame;
+            AllocationHandle allocation;
+            std::function<void()> release;
+        };
+
+        std::vector<DeferredRelease> mDeferredReleases;
+        std::mutex mDeferredReleasesMutex;
+        std::atomic<uint64_t> mFrame{0};
+        uint64_t mCompletedFrame{0};
+        std::vector<uint64_t> mImageFrames;
+
+        mutable std::array<std::mutex, VK_MAX_MEMORY_TYPES> mMemoryTypeMutexes;
+        mutable std::mutex mInfoMutex;
+        std::shared_mutex mThreadCachesMutex;
+        std::unordered_map<std::thread::id, std::unique_ptr<ThreadCache>> mThreadCaches;
+
+        std::array<std::atomic<VkDeviceSize>, VK_MAX_MEMORY_TYPES> mUsedBytes{};
+        std::array<std::atomic<VkDeviceSize>, VK_MAX_MEMORY_TYPES> mSlabRequestedBytes{};     /* Slots handed out, cached ones excluded */
+        std::array<std::atomic<VkDeviceSize>, VK_MAX_MEMORY_TYPES> mPeakUsedBytes{};
+        std::array<std::atomic<VkDeviceSize>, VK_MAX_MEMORY_HEAPS> mHeapPeakUsedBytes{};
+        std::atomic<VkDeviceSize> mTotalPeakUsedBytes{0};
+
+        /* The following functions expect the lock of the memory type to be held */
+        uint32_t allocate(uint32_t memoryTypeIndex, VkDeviceSize minimumSize, ResourceTiling tiling);
+        uint32_t allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer buffer, VkImage image);
+        uint32_t insertChunk(uint32_t memoryTypeIndex, std::unique_ptr<Chunk> chunk);
+        void releaseChunkIfUnused(uint32_t memoryTypeIndex, uint32_t chunkIndex);
+        bool reserveInExistingChunks(uint32_t memoryTypeIndex, VkMemoryRequirements& memoryRequirements, ResourceTiling tiling,
+                                     BufferInfo& info, uint32_t excludedChunkIndex = NoChunk);
+        void freeBlock(const BufferInfo& info);
+        bool reserveInSlab(uint32_t memoryTypeIndex, uint32_t sizeClass, VkDeviceSize requestedSize, BufferInfo& info);
+        bool addSlab(uint32_t memoryTypeIndex, uint32_t sizeClass);
+        void recordChunkPeak(uint32_t memoryTypeIndex);
+        void updateUsage(uint32_t memoryTypeIndex);
+        MemoryUsageStatistics getChunksStatistics(uint32_t memoryTypeIndex);
+        static void updatePeak(std::atomic<VkDeviceSize>& peak, VkDeviceSize value);
+        static void accumulate(MemoryUsageStatistics& total, const MemoryUsageStatistics& statistics);
+        static void computeExternalFragmentation(MemoryUsageStatistics& statistics);
+        static const char* getStrategyName(AllocationStrategy strategy);
+
+        void prewarm(const AllocationProfile& profile);
+        bool needsDedicatedAllocation(VkMemoryRequirements& memoryRequirements, VkBuffer buffer, VkImage image);
+        BufferInfo reserve(VkMemoryRequirements& memoryRequirements, const MemoryTypeRequest& request,
+                           VkBuffer buffer, VkImage image, ResourceTiling tiling);
+        bool reserveInMemoryType(uint32_t memoryTypeIndex, VkMemoryRequirements& memoryRequirements, bool dedicated,
+                                 VkBuffer buffer, VkImage image, ResourceTiling tiling, BufferInfo& info);
+        void release(const BufferInfo& info);
+        void releaseAllocation(AllocationHandle handle);
+        void queueRelease(AllocationHandle handle, std::function<void()> release);
+        void runDeferredReleases(bool all);
+        AllocationHandle registerAllocation(const BufferInfo& info, VkBuffer buffer, VkImage image,
+                                            const std::string& name, VkDeviceSize size);
+        Chunk& getChunk(const BufferInfo& info);
+
+        ThreadCache& getThreadCache();
+        bool reserveFromThreadCache(uint32_t memoryTypeIndex, uint32_t sizeClass, VkDeviceSize requestedSize, BufferInfo& info);
+        void flushThreadCache(ThreadCache& cache, uint32_t memoryTypeIndex, uint32_t sizeClass, size_t count);
 
-        std::map<uint32_t, std::vector<Chunk>> mChunksMap;
-        std::map<VkBuffer, BufferInfo> mBuffersInfo;
-        std::map<VkImage, BufferInfo> mImagesInfo;
+        static constexpr uint32_t NoChunk{0xFFFFFFFF};
 
-        void allocate(uint32_t memoryTypeIndex);
-        int32_t findMemoryType(VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags& properties);
+        friend class Defragmenter;
+        std::vector<uint32_t> findMemoryTypes(uint32_t memoryTypeBits, const MemoryTypeRequest& request) const;
+        static MemoryTypeRequest getMemoryTypeRequest(MemoryUsage usage);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef __MEMORY_STATISTICS_HPP__
+#define __MEMORY_STATISTICS_HPP__
+
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+struct MemoryUsageStatistics {
+    VkDeviceSize reservedBytes{0};          /* Device memory allocated in chunks */
+    VkDeviceSize usedBytes{0};              /* Bytes covered by blocks, cached blocks included */
+    VkDeviceSize requestedBytes{0};         /* Bytes the resources asked for */
+    VkDeviceSize peakUsedBytes{0};
+    VkDeviceSize internalFragmentation{0};  /* usedBytes - requestedBytes */
+    VkDeviceSize largestFreeBlock{0};
+    float externalFragmentation{0.0f};      /* 1 - largestFreeBlock / free bytes */
+    uint32_t chunkCount{0};
+    uint32_t dedicatedChunkCount{0};
+    uint32_t allocationCount{0};
+    uint32_t freeBlockCount{0};
+};
+
+struct MemoryHeapStatistics {
+    VkDeviceSize heapSize{0};
+    VkMemoryHeapFlags flags{0};
+    MemoryUsageStatistics usage;
+};
+
+struct MemoryTypeStatistics {
+    uint32_t heapIndex{0};
+    VkMemoryPropertyFlags flags{0};
+    MemoryUsageStatistics usage;
+};
+
+/* How much of a heap the process may use, and how much it already does */
+struct MemoryHeapBudget {
+    VkDeviceSize budget{0};
+    VkDeviceSize usage{0};
+};
+
+struct MemoryStatistics {
+    std::vector<MemoryHeapStatistics> heaps;
+    std::vector<MemoryTypeStatistics> types;
+    MemoryUsageStatistics total;
+};
+
+#endif
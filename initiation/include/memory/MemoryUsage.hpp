@@ -0,0 +1,23 @@
+#ifndef __MEMORY_USAGE_HPP__
+#define __MEMORY_USAGE_HPP__
+
+#include <vulkan/vulkan.h>
+
+/**
+ * How a resource is accessed, used to rank the memory types able to hold it.
+ *
+ * GpuOnly:        written and read by the device only (render targets, static geometry, textures).
+ * CpuToGpu:       written once by the host and read once by the device (staging), kept out of device memory.
+ * GpuToCpu:       written by the device and read back by the host.
+ * FrameConstants: rewritten by the host every frame and read by the device, the fastest host writable type.
+ * Transient:      attachments living within a render pass, lazily allocated memory when the device has some.
+ */
+enum class MemoryUsage { GpuOnly, CpuToGpu, GpuToCpu, FrameConstants, Transient };
+
+struct MemoryTypeRequest {
+    VkMemoryPropertyFlags requiredFlags{0};
+    VkMemoryPropertyFlags preferredFlags{0};
+    VkMemoryPropertyFlags unwantedFlags{0};
+};
+
+#endif
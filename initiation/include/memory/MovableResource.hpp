@@ -0,0 +1,28 @@
+#ifndef __MOVABLE_RESOURCE_HPP__
+#define __MOVABLE_RESOURCE_HPP__
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include <vulkan/vulkan.h>
+
+using BufferMoveCallback = std::function<void(VkBuffer oldBuffer, VkBuffer newBuffer)>;
+using ImageMoveCallback = std::function<void(VkImage oldImage, VkImage newImage)>;
+
+/**
+ * A buffer or a color image the defragmenter is allowed to relocate. The
+ * resource is recreated from its create info and bound to another block, its
+ * allocation handle stays the same. The owner is called back as soon as the
+ * copy is recorded, so that what it records next uses the new handle.
+ */
+struct MovableResource {
+    VkBufferCreateInfo bufferCreateInfo{};
+    VkImageCreateInfo imageCreateInfo{};
+    VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};        /* The image is kept in it between its uses */
+    std::vector<uint32_t> queueFamilyIndices;
+    BufferMoveCallback onBufferMove;
+    ImageMoveCallback onImageMove;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef __SLAB_ALLOCATOR_HPP__
+#define __SLAB_ALLOCATOR_HPP__
+
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/BufferInfo.hpp"
+
+/**
+ * Packs the small blocks of one memory type into slabs.
+ *
+ * A slab is a single SlabSize block reserved in a chunk and cut into equal
+ * slots of one size class, from MinimumSize to 64 KB. Free slots are tracked
+ * by a bitmap, so that reserve and free are constant time. It is not thread
+ * safe, the lock of its memory type guards it.
+ */
+class SlabAllocator {
+    public:
+        static constexpr VkDeviceSize MinimumSize{256};
+        static constexpr uint32_t SizeClassCount{9};
+        static constexpr VkDeviceSize SlabSize{256 * 1024};
+
+        static uint32_t getSizeClass(VkDeviceSize size);
+        static VkDeviceSize getClassSize(uint32_t sizeClass);
+
+        bool reserve(uint32_t sizeClass, VkDeviceSize requestedSize, BufferInfo& info);
+        void addSlab(uint32_t sizeClass, const BufferInfo& slabInfo);
+        bool free(const BufferInfo& info, BufferInfo& emptySlabInfo);
+        void clear();
+        uint32_t getSlabCount(uint32_t sizeClass) const;
+
+    private:
+        static constexpr uint32_t InvalidIndex{0xFFFFFFFF};
+        static constexpr uint32_t WordCount{static_cast<uint32_t>(SlabSize / MinimumSize / 64)};
+
+        struct Slab {
+            BufferInfo info;
+            uint32_t sizeClass;
+            uint32_t slotCount;
+            uint32_t freeCount;
+            uint32_t partialPosition{InvalidIndex};
+            std::array<uint64_t, WordCount> freeBits;
+        };
+
+        std::vector<Slab> mSlabs;
+        std::vector<uint32_t> mUnusedSlabs;
+        std::array<std::vector<uint32_t>, SizeClassCount> mPartialSlabs;
+        std::unordered_map<uint64_t, uint32_t> mSlabIndices;
+        std::array<uint32_t, SizeClassCount> mSlabCounts{};
+
+        void addPartial(uint32_t slabIndex);
+        void removePartial(uint32_t slabIndex);
+
+        static uint64_t getKey(uint32_t chunkIndex, size_t offset);
+};
+
+#endif
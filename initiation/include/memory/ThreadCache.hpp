@@ -0,0 +1,27 @@
+#ifndef __THREAD_CACHE_HPP__
+#define __THREAD_CACHE_HPP__
+
+#include <array>
+#include <vector>
+#include <mutex>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/BufferInfo.hpp"
+#include "memory/SlabAllocator.hpp"
+
+/**
+ * Small blocks reserved in advance by one thread, so that most small
+ * allocations don't need the memory type lock. Blocks are slab slots grouped
+ * by memory type and by slab size class.
+ */
+struct ThreadCache {
+    static constexpr uint32_t SizeClassCount{SlabAllocator::SizeClassCount};
+    static constexpr uint32_t BatchSize{8};
+    static constexpr uint32_t MaximumBlockCount{2 * BatchSize};
+
+    std::mutex mutex;
+    std::array<std::array<std::vector<BufferInfo>, SizeClassCount>, VK_MAX_MEMORY_TYPES> blocks;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __TLSF_ALLOCATOR_HPP__
+#define __TLSF_ALLOCATOR_HPP__
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "memory/Block.hpp"
+
+/**
+ * Two-Level Segregated Fit allocator of offsets in a range of 'size' bytes.
+ *
+ * Free blocks are binned by the position of their most significant bit (first
+ * level) and 2^SecondLevelLog2 linear subdivisions of it (second level). Two
+ * bitmaps give the first non-empty bin in O(1), so reserve and free are O(1)
+ * and a block wastes at most one granularity unit plus 1/16th of its size.
+ * Block bookkeeping lives in a node pool and grows with the number of blocks,
+ * not with the size of the range.
+ */
+class TlsfAllocator {
+    public:
+        TlsfAllocator(const size_t size, const size_t granularity);
+        AllocationResult reserve(const size_t blockSize, const size_t alignment = 1);
+        bool free(Block block);
+        void getFreeBlocks(std::vector<Block>& freeBlocks) const;
+
+        size_t getSize() const;
+        size_t getUsedSize() const;
+        size_t getRequestedSize() const;
+
+    private:
+        static constexpr uint32_t InvalidIndex{0xFFFFFFFF};
+        static constexpr uint32_t FirstNode{0};     /* Splits and merges keep the lowest node, it stays at offset 0 */
+        static constexpr uint32_t SecondLevelLog2{4};
+        static constexpr uint32_t SecondLevelCount{1u << SecondLevelLog2};
+
+        struct Node {
+            size_t offset;
+            size_t size;
+            uint32_t previousPhysical{InvalidIndex};
+            uint32_t nextPhysical{InvalidIndex};
+            uint32_t previousFree{InvalidIndex};
+            uint32_t nextFree{InvalidIndex};
+            bool free{false};
+        };
+
+        size_t mSize;
+        size_t mUsedSize{0};
+        size_t mRequestedSize{0};
+        size_t mGranularity;
+        uint32_t mFirstLevelCount;
+
+        uint32_t mFirstLevelBitmap{0};
+        std::vector<uint32_t> mSecondLevelBitmaps;
+        std::vector<uint32_t> mFreeListHeads;
+
+        std::vector<Node> mNodes;
+        std::vector<uint32_t> mUnusedNodes;
+        std::unordered_map<size_t, uint32_t> mNodeAtOffset;     /* Allocated blocks only, by offset */
+
+        void mapping(const size_t units, uint32_t& firstLevel, uint32_t& secondLevel) const;
+        bool findSuitable(const size_t units, uint32_t& firstLevel, uint32_t& secondLevel) const;
+
+        void insertFree(const uint32_t nodeIndex);
+        void removeFree(const uint32_t nodeIndex);
+        uint32_t split(const uint32_t nodeIndex, const size_t size);
+        void merge(const uint32_t nodeIndex, const uint32_t nextIndex);
+
+        uint32_t createNode(const size_t offset, const size_t size);
+        void releaseNode(const uint32_t nodeIndex);
+
+        static uint32_t mostSignificantBit(const size_t n);
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef __TLSF_CHUNK_HPP__
+#define __TLSF_CHUNK_HPP__
+
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/Chunk.hpp"
+#include "memory/TlsfAllocator.hpp"
+
+/**
+ * Two-Level Segregated Fit allocator over a single VkDeviceMemory, the
+ * offsets are managed by a TlsfAllocator.
+ */
+class TlsfChunk : public Chunk {
+    public:
+        TlsfChunk(VkDeviceMemory memory, const size_t chunkSize, const size_t granularity = Granularity);
+        AllocationResult reserve(const size_t blockSize, const size_t alignment = 1) override;
+        bool free(Block block) override;
+        AllocationStrategy getStrategy() const override;
+        void getFreeBlocks(std::vector<Block>& freeBlocks) const override;
+
+        static size_t Granularity;
+
+    private:
+        TlsfAllocator mAllocator;
+};
+
+#endif
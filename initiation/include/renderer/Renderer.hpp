@@ -19,6 +19,7 @@
 #include "renderer/mesh/MeshManager.hpp"
 #include "renderer/light/Light.hpp"
 #include "memory/MemoryManager.hpp"
+#include "memory/Defragmenter.hpp"
 #include "resources/TextureManager.hpp"
 #include "environment.hpp"
 
@@ -62,7 +63,7 @@ class Renderer {
         std::vector<VkSemaphore> mRenderFinishedSemaphores;
         VkDescriptorPool mDescriptorPool;
         VkDescriptorSetLayout mCameraDescriptorSetLayout;
-        VkDescriptorSet mDescriptorSet;
+        VkDescriptorSet mCameraDescriptorSet;
         VkExtent2D mExtent;
         std::vector<FenceInfo> mFencesInfo;
         std::vector<VkCommandPool> mCommandPools;
@@ -83,16 +84,17 @@ class Renderer {
         Shader mFragmentShader;
 
         MeshManager* mMeshManager;
+        Defragmenter mDefragmenter;
 
         uint32_t mNextImageIndex;
         std::array<VkClearValue, 3> mClearValues;
 
-        std::vector<VkBuffer> mCameraUniformBuffers;
-        std::vector<VkDescriptorSet> mCameraDescriptorSets;
-
+        /* The render pass orders the attachment writes of consecutive frames, so they can all share one set */
+        static constexpr uint32_t AttachmentSetCount{1};
         std::vector<RendererAttachments> mFramebufferAttachments;
 
         std::vector<VkSemaphore> mToWaitSemaphores;
+        std::vector<VkPipelineStageFlags> mToWaitStages;
 
         bool mCreated{false};
         bool mBypassRendering{false};
@@ -108,8 +110,9 @@ class Renderer {
         void createDescriptorPool();
         void createDescriptorSetLayout();
         void createCommandBuffers();
-        void createCameraUniformBuffers();
-        void createCameraDescriptorSets();
+        void createCameraDescriptorSet();
+        void writeCameraDescriptorSet();
+        void recreateImageResources();
         void createSemaphores();
         void createFences();
         void createCommandPools();
@@ -117,7 +120,7 @@ class Renderer {
         FrameBufferAttachment createAttachment(VkFormat format,
                                                VkImageUsageFlags usage,
                                                VkImageAspectFlags aspect);
-        void updateUniformBuffer(uint32_t index);
+        uint32_t updateUniformBuffer();
 
         VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
         VkFormat findDepthFormat();
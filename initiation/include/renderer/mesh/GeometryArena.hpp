@@ -0,0 +1,49 @@
+#ifndef GEOMETRYARENA
+#define GEOMETRYARENA
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "memory/TlsfAllocator.hpp"
+
+struct GeometryRange {
+    uint32_t offset{0};     /* In elements, from the start of the arena */
+    uint32_t count{0};
+    uint32_t segment{0};
+    Block block;
+};
+
+/**
+ * Element ranges of a persistent geometry buffer (vertices or indices).
+ *
+ * Ranges are managed by TLSF allocators working on element offsets only, so
+ * that freed ranges are reused by the next meshes. When the arena is full it
+ * grows by a segment covering a new tail as big as everything before it: the
+ * existing ranges keep their offsets and the buffer only has to be copied
+ * into a bigger one.
+ */
+class GeometryArena {
+    public:
+        GeometryArena(uint32_t initialCapacity);
+
+        GeometryRange allocate(uint32_t count);
+        void free(const GeometryRange& range);
+
+        uint32_t getCapacity() const;
+
+    private:
+        static constexpr size_t Granularity{4};
+
+        struct Segment {
+            uint32_t base;
+            std::unique_ptr<TlsfAllocator> ranges;
+        };
+
+        std::vector<Segment> mSegments;
+        uint32_t mCapacity{0};
+
+        void addSegment(uint32_t size);
+};
+
+#endif
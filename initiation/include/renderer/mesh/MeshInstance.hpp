@@ -0,0 +1,31 @@
+#ifndef MESHINSTANCE
+#define MESHINSTANCE
+
+#include "renderer/mesh/Mesh.hpp"
+#include "resources/Texture.hpp"
+#include "Transform.hpp"
+
+/**
+ * A placement of the geometry of a mesh, with its own transform and texture.
+ *
+ * The instances of a mesh share a single copy of its geometry and are drawn
+ * together. The mesh must outlive its instances, but doesn't need to be drawn
+ * itself. The texture is read when the instance is added to the mesh manager.
+ */
+class MeshInstance {
+    public:
+        MeshInstance(Mesh& mesh);
+
+        Mesh& getMesh();
+        Transform& getTransform();
+        Texture& getTexture();
+
+        void setTexture(Texture& texture);
+    private:
+        Mesh* mMesh;
+        Texture* mTexture{nullptr};     /* The texture of the mesh when not set */
+
+        Transform mTransform;
+};
+
+#endif
@@ -6,26 +6,81 @@
 #include <array>
 #include <map>
 #include <atomic>
-#include <queue>
 
 #include <vulkan/vulkan.h>
 
 #include "renderer/mesh/Mesh.hpp"
+#include "renderer/mesh/MeshInstance.hpp"
+#include "memory/BufferPool.hpp"
+#include "memory/FrameAllocator.hpp"
+#include "renderer/mesh/GeometryArena.hpp"
+
+class TextureManager;
+
+struct InstanceData {
+    MeshInstance* instance;
+    uint32_t textureIndex;
+    uint32_t modelIndex{0};         /* Per mesh path, index of its model matrix this frame */
+};
+
+/* A geometry content, copied once however many meshes with this content and instances draw it */
+struct GeometryRecord {
+    GeometryRange vertexRange;
+    GeometryRange indexRange;
+    bool resident{false};           /* Copied, or being copied by a transfer the frames wait for */
+    uint64_t hash{0};
+    uint32_t useCount{0};           /* Meshes bound to it */
+    const Mesh* source{nullptr};    /* One of these meshes, to compare the content of the next ones */
+
+    std::vector<InstanceData> instances;
+};
+
+/* The geometry a mesh is bound to while the mesh or its instances are drawn */
+struct GeometryBinding {
+    GeometryRecord* geometry{nullptr};
+    uint32_t useCount{0};           /* The mesh itself and its instances */
+};
 
 struct MeshData {
     VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
-    uint32_t uniformBufferDynamicOffset{0};
+    uint32_t modelIndex{0};
+    uint32_t textureVersion{0};
+    uint32_t textureIndex{0};
     bool free{true};
+
+    GeometryRecord* geometry{nullptr};
 };
 
-struct RenderBuffers {
-    VkBuffer vertexBuffer;
-    VkBuffer indexBuffer;
-    uint32_t vertexBufferSize{0};
-    uint32_t vertexBufferSizeInBytes{0};
-    uint32_t indexBufferSize{0};
-    uint32_t indexBufferSizeInBytes{0};
-    bool needUpdate{false};
+/* The device local geometry shared by every frame, laid out as the arenas */
+struct GeometryBuffers {
+    BufferRange vertexBuffer;
+    BufferRange indexBuffer;
+    uint32_t vertexCapacity{0};
+    uint32_t indexCapacity{0};
+};
+
+/* Per draw data of the indirect path, read by the shaders at the first instance index (std430) */
+struct DrawData {
+    glm::mat4 model;
+    uint32_t textureIndex;
+    uint32_t padding[3];
+};
+
+/* A texture used by meshes or instances, its slot is its index in the texture array of the indirect path */
+struct TextureSlot {
+    Texture* texture{nullptr};
+    uint32_t useCount{0};
+    uint32_t textureVersion{0};
+    VkDescriptorSet descriptorSet{VK_NULL_HANDLE};  /* Per mesh path, the instances are drawn with it */
+};
+
+/* A geometry written in the staging memory, until its copy completes */
+struct GeometryUpload {
+    GeometryRecord* geometry;       /* nullptr once the geometry isn't used anymore */
+    BufferRange staging;
+    GeometryRange vertexRange;
+    GeometryRange indexRange;
+    bool submitted{false};
 };
 
 class MeshManager {
@@ -37,57 +92,93 @@ class MeshManager {
         void operator=(const MeshManager& other) = delete;
         void operator=(const MeshManager&& other) = delete;
 
-        void create(VulkanContext& context);
+        void create(VulkanContext& context, TextureManager& textureManager);
         void destroy();
 
         void addMesh(Mesh& mesh);
         void removeMesh(Mesh& mesh);
 
+        void addInstance(MeshInstance& instance);
+        void removeInstance(MeshInstance& instance);
+
         void setImageCount(uint32_t count);
 
-        void update(uint32_t imageIndex);
+        VkSemaphore update(uint32_t imageIndex);
 
         VkCommandBuffer render(VkRenderPass renderPass, VkFramebuffer frameBuffer, VkCommandPool commandPool,
-                               VkDescriptorSet cameraDescriptorSet, VkPipelineLayout pipelineLayout, VkPipeline pipeline,
+                               VkDescriptorSet cameraDescriptorSet, uint32_t cameraDynamicOffset,
+                               VkPipelineLayout pipelineLayout, VkPipeline pipeline,
                                uint32_t imageIndex);
         VkDescriptorSetLayout getDescriptorSetLayout() const;
+        bool isIndirectDrawEnabled() const;
+        VkDeviceSize getFrameDataSize() const;
 
         static constexpr size_t MaximumMeshCount{1024};
+        static constexpr size_t MaximumInstanceCount{16384};
+        static constexpr size_t MaximumDrawDataCount{MaximumMeshCount + MaximumInstanceCount};
+        static constexpr uint32_t InitialVertexCapacity{65536};
+        static constexpr uint32_t InitialIndexCapacity{3 * 65536};
+        static constexpr uint32_t MaximumTextureCount{256};
     private:
         struct {
-            std::vector<RenderBuffers> renderBuffers;
-            RenderBuffers stagingBuffers;
+            GeometryBuffers geometryBuffers;
 
-            VkBuffer modelTransformBuffer;
-            uint32_t modelTransformBufferSize{0};
+            /* Per mesh path, the model matrices of the frame read at the instance index (std430) */
             VkDescriptorSetLayout descriptorSetLayout;
+            FrameAllocation modelMatrices;
             std::array<MeshData, MaximumMeshCount> meshDataPool;
             std::map<Mesh*, MeshData*> meshDataBinding;
+            std::multimap<uint64_t, GeometryRecord> geometries;     /* By content hash */
+            std::map<const Mesh*, GeometryBinding> geometryBindings;
+
+            /* Indirect path, one set per image as the texture array changes while frames are in flight */
+            VkDescriptorSetLayout indirectDescriptorSetLayout{VK_NULL_HANDLE};
+            std::vector<VkDescriptorSet> indirectDescriptorSets;
+            std::vector<uint32_t> indirectDescriptorVersions;
+            FrameAllocation drawData;
+            FrameAllocation drawCommands;
+            uint32_t drawCount{0};
         } mRenderData;
 
-        bool mNeedStagingUpdate{false};
-
-        std::queue<VkBuffer> mToFreeQueue;
-        std::vector<RenderBuffers> mTemporaryStaticBuffers;
-        std::vector<bool> mShouldSwapBuffers;
-        std::vector<bool> mFirstTransfer;
+        bool mIndirectDraw{false};
+        std::array<TextureSlot, MaximumTextureCount> mTextureSlots;
+        uint32_t mTextureSlotsVersion{1};
 
-        std::vector<Mesh*> mTemporaryMeshes;
+        GeometryArena mVertexArena{InitialVertexCapacity};
+        GeometryArena mIndexArena{InitialIndexCapacity};
+        std::vector<GeometryUpload> mUploads;
 
         VulkanContext* mContext;
+        TextureManager* mTextureManager;
 
-        std::vector<VkFence> mTransferCompleteFences;
+        VkFence mTransferCompleteFence{VK_NULL_HANDLE};
+        VkSemaphore mTransferCompleteSemaphore{VK_NULL_HANDLE};
+        VkCommandBuffer mTransferCommandBuffer{VK_NULL_HANDLE};
         std::vector<VkEvent> mEvents;
 
         std::vector<Mesh*> mMeshes;
+        size_t mInstanceCount{0};
 
         void createDescriptorSetLayout();
-        void allocateUniformBuffer();
         void allocateDescriptorSets();
         void updateDescriptorSet(Mesh& mesh, MeshData& meshData);
-        void updateUniformBuffer();
-        void updateStagingBuffers();
-        void updateStaticBuffers(uint32_t imageIndex);
+        void writeDescriptorSet(VkDescriptorSet descriptorSet, Texture& texture);
+        void updateModelMatrices();
+        void createIndirectDescriptorSetLayout();
+        void updateIndirectDescriptorSet(uint32_t imageIndex);
+        void updateDrawBuffers();
+        void recordDraws(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+        void recordIndirectDraws(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t imageIndex);
+        uint32_t acquireTextureSlot(Texture& texture);
+        void releaseTextureSlot(uint32_t index);
+        void updateTextureSlots();
+        GeometryRecord* acquireGeometry(Mesh& mesh);
+        GeometryRecord* findGeometry(const Mesh& mesh, uint64_t hash);
+        void releaseGeometry(const Mesh& mesh);
+        void createTransferSynchronization();
+        void completeTransfer();
+        bool submitTransfer();
+        void growGeometryBuffers(VkCommandBuffer commandBuffer);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef RESIDENCYMANAGER
+#define RESIDENCYMANAGER
+
+#include <array>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "memory/MemoryManager.hpp"
+#include "resources/Texture.hpp"
+
+/**
+ * Keeps the resident textures within the memory budget of their heap.
+ *
+ * Each heap has its own budget, so only the textures of the heap that is over
+ * budget are considered for eviction.
+ *
+ * Textures are ordered from the least to the most recently used one. A texture
+ * can only be evicted once no frame in flight may still sample it, so that the
+ * descriptor sets pointing to it can be rewritten when it is uploaded again.
+ */
+class ResidencyManager {
+    public:
+        void create(MemoryManager& memoryManager);
+        void setImageCount(uint32_t count);
+        void beginFrame();
+
+        void add(Texture& texture, uint32_t heapIndex);
+        void remove(Texture& texture);
+        void touch(Texture& texture);
+
+        bool isHeapUsed(uint32_t heapIndex) const;
+        bool isOverBudget(uint32_t heapIndex, VkDeviceSize requestedSize, VkDeviceSize releasedSize);
+        Texture* getEvictionCandidate(uint32_t heapIndex) const;
+
+    private:
+        struct Entry {
+            std::list<Texture*>::iterator position;
+            uint64_t lastUsedFrame{0};
+            uint32_t heapIndex{0};
+            bool used{false};
+        };
+
+        MemoryManager* mMemoryManager;
+        std::list<Texture*> mLeastRecentlyUsed;
+        std::unordered_map<Texture*, Entry> mEntries;
+        uint64_t mFrame{0};
+        uint32_t mImageCount{1};
+        std::array<uint32_t, VK_MAX_MEMORY_HEAPS> mHeapTextureCounts{};
+};
+
+#endif
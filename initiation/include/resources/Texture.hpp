@@ -1,6 +1,8 @@
 #ifndef TEXTURE
 #define TEXTURE
 
+#include <string>
+
 #include <vulkan/vulkan.h>
 
 #include "vulkan/image/Image.hpp"
@@ -18,11 +20,24 @@ class Texture {
         void setImageView(ImageView imageView);
         void setSampler(Sampler sampler);
         void setImage(Image image);
+
+        const std::string& getFilename() const;
+        void setFilename(std::string filename);
+        VkDeviceSize getSize() const;
+        void setSize(VkDeviceSize size);
+        bool isResident() const;
+        void setResident(bool resident);
+        uint32_t getVersion() const;
+        void invalidate();
         
     private:
         Image mImage;
         ImageView mImageView;
         Sampler mSampler;
+        std::string mFilename;
+        VkDeviceSize mSize{0};
+        bool mResident{false};
+        uint32_t mVersion{0};   /* Bumped every time the image is uploaded again */
 };
 
 #endif
\ No newline at end of file
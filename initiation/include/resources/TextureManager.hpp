@@ -6,6 +6,7 @@
 
 #include "vulkan/VulkanContext.hpp"
 #include "resources/Texture.hpp"
+#include "resources/ResidencyManager.hpp"
 
 class TextureManager {
     public:
@@ -15,14 +16,25 @@ class TextureManager {
         Texture& load(std::string name, std::string filename);
         Texture& getTexture(std::string name);
 
+        void setImageCount(uint32_t count);
+        void beginFrame();
+        void use(Texture& texture);
+
     private:
         VulkanContext* mContext;
         std::map<std::string, Texture> mTextures;
+        ResidencyManager mResidencyManager;
+
+        void makeResident(Texture& texture);
+        void evict(Texture& texture);
+        void move(Texture& texture, VkImage image);
+        void makeRoom(uint32_t heapIndex, VkDeviceSize size);
 
-        VkBuffer _loadToStaging(std::string& filename,
-                                uint32_t& width,
-                                uint32_t& height);
+        BufferRange _loadToStaging(std::string& filename,
+                                   uint32_t& width,
+                                   uint32_t& height);
         Image _createImage(std::string& filename);
+        void _allocateImage(Image& image, std::string& filename);
         ImageView _createImageView(Image& image);
         Sampler _createSampler();
 };
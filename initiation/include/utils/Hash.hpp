@@ -0,0 +1,17 @@
+#ifndef HASH
+#define HASH
+
+#include <cstdint>
+#include <cstddef>
+
+class Hash {
+    public:
+        /**
+         * 64 bit xxHash of the bytes, chain calls through the seed to hash
+         * several streams. Not meant to resist attacks, equal hashes must still
+         * be confirmed by comparing the data.
+         */
+        static uint64_t xxHash64(const void* data, size_t size, uint64_t seed = 0);
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <thread>
+#include <mutex>
 #include <unordered_map>
 
 #include <vulkan/vulkan.h>
@@ -23,6 +24,7 @@ class VulkanContext {
         VkPhysicalDevice getPhysicalDevice() const;
         VkDevice getDevice() const;
         VkPhysicalDeviceLimits getLimits() const;
+        VkPhysicalDeviceFeatures getEnabledFeatures() const;
         VkQueue getPresentQueue() const;
         VkQueue getTransferQueue() const;
         VkQueue getGraphicsQueue() const;
@@ -44,10 +46,13 @@ class VulkanContext {
         VkSurfaceKHR mSurface;                              // Vulkan surface handler
         QueueFamilyIndices mIndices;
         std::unordered_map<std::thread::id, CommandPool> mTransferCommandPoolMap;
+        std::mutex mTransferCommandPoolMutex;
         VkDebugUtilsMessengerEXT mCallback;                 // Message callback for validation layer
         MemoryManager mMemoryManager;
         VkPhysicalDeviceLimits mPhysicalDeviceLimits;
+        VkPhysicalDeviceFeatures mEnabledFeatures{};
         DescriptorPool mDescriptorPool;
+        bool mPhysicalDeviceProperties2Enabled{false};
 
         const std::vector<const char*> validationLayers = {
             "VK_LAYER_LUNARG_standard_validation"
@@ -57,6 +62,12 @@ class VulkanContext {
             VK_KHR_SWAPCHAIN_EXTENSION_NAME
         };
 
+        /* Enabled only when the device supports them */
+        const std::vector<const char*> optionalDeviceExtension = {
+            VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME,
+            VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME
+        };
+
         #ifdef DEBUG
             const bool enableValidationLayers{true};       // We want the validation layer in debug mode
         #else
@@ -71,6 +82,8 @@ class VulkanContext {
         void setupDebugCallback();
     
         bool checkValidationLayerSupport();
+        bool checkDeviceExtensionSupport(const char* extensionName);
+        bool checkInstanceExtensionSupport(const char* extensionName);
 
         std::vector<const char*> getRequiredExtensions();
 
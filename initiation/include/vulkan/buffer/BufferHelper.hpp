@@ -9,13 +9,13 @@
 
 class BufferHelper {
     public:
-        static void createBuffer(VulkanContext& context,
-                                 VkDeviceSize size,
-                                 VkBufferUsageFlags usage,
-                                VkSharingMode sharingMode,
-                                 VkMemoryPropertyFlags properties,
-                                 VkBuffer& buffer,
-                                 std::string name);
+        static AllocationHandle createBuffer(VulkanContext& context,
+                                            VkDeviceSize size,
+                                            VkBufferUsageFlags usage,
+                                            VkSharingMode sharingMode,
+                                            MemoryUsage memoryUsage,
+                                            VkBuffer& buffer,
+                                            std::string name);
         static void copyBuffer(VulkanContext& context,
                                CommandPool& commandPool,
                                VkQueue queue,
@@ -26,6 +26,7 @@ class BufferHelper {
                                       CommandPool& commandPool,
                                       VkQueue queue,
                                       VkBuffer buffer,
+                                      VkDeviceSize bufferOffset,
                                       VkImage image,
                                       uint32_t width,
                                       uint32_t height);
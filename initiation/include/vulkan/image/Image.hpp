@@ -28,11 +28,16 @@ class Image {
         void setFlags(VkFlags flags);
 
         VkImage getHandler();
+        void setHandler(VkImage image);     /* The image has been moved, its allocation stays the same */
+        const VkImageCreateInfo& getInfo() const;
+        void setAllocation(AllocationHandle allocation);
+        AllocationHandle getAllocation() const;
 
     private:
         void _createImage(VkDevice device, MemoryManager& manager);
 
         VkImage mImage;
+        AllocationHandle mAllocation;   /* Destroys the image as well when freed */
         VkImageCreateInfo mInfo{};
         bool mCreated{false};
 };
@@ -10,7 +10,8 @@ class ImageHelper {
         static VkImage create(VulkanContext& context,
                            uint32_t width, uint32_t height,
                            VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                           VkMemoryPropertyFlags properties);
+                           VkMemoryPropertyFlags properties,
+                           AllocationHandle& allocation);
         static VkImageView createImageView(VulkanContext& context,
                                     VkImage image,
                                     VkFormat format,
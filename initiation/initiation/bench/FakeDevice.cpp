@@ -0,0 +1,188 @@
+#include "FakeDevice.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <cstring>
+
+namespace {
+    struct FakeMemory {
+        VkDeviceSize size;
+        uint32_t heapIndex;
+        std::unique_ptr<uint8_t[]> data;    /* Only allocated once mapped */
+    };
+
+    struct FakeBuffer {
+        VkDeviceSize size;
+    };
+
+    struct FakeImage {
+        VkImageTiling tiling;
+    };
+
+    constexpr uint32_t maxAllocationCount{4096};
+
+    std::mutex fakeMutex;
+    FakeDeviceStatistics fakeStatistics;
+    VkDeviceSize heapAllocatedBytes[VK_MAX_MEMORY_HEAPS]{};
+    VkDeviceSize bufferImageGranularity{1024};
+
+    VkPhysicalDeviceMemoryProperties makeMemoryProperties() {
+        VkPhysicalDeviceMemoryProperties properties{};
+
+        properties.memoryHeapCount = 3;
+        properties.memoryHeaps[0] = {8ull * 1024 * 1024 * 1024, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT};
+        properties.memoryHeaps[1] = {16ull * 1024 * 1024 * 1024, 0};
+        properties.memoryHeaps[2] = {256ull * 1024 * 1024, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT};
+
+        properties.memoryTypeCount = 5;
+        properties.memoryTypes[0] = {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0};
+        properties.memoryTypes[1] = {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1};
+        properties.memoryTypes[2] = {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                     VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 1};
+        properties.memoryTypes[3] = {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 2};
+        properties.memoryTypes[4] = {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, 0};
+
+        return properties;
+    }
+
+    const VkPhysicalDeviceMemoryProperties fakeMemoryProperties = makeMemoryProperties();
+}
+
+void FakeDevice::reset() {
+    std::lock_guard<std::mutex> lock(fakeMutex);
+    fakeStatistics.peakAllocatedBytes = fakeStatistics.allocatedBytes;
+    fakeStatistics.allocationCount = 0;
+    fakeStatistics.bindCount = 0;
+}
+
+FakeDeviceStatistics FakeDevice::getStatistics() {
+    std::lock_guard<std::mutex> lock(fakeMutex);
+    return fakeStatistics;
+}
+
+void FakeDevice::setBufferImageGranularity(VkDeviceSize granularity) {
+    bufferImageGranularity = granularity;
+}
+
+VkDeviceSize FakeDevice::getBufferImageGranularity() {
+    return bufferImageGranularity;
+}
+
+/* The definitions keep the linkage of the declarations in vulkan.h */
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(VkPhysicalDevice,
+                                                         VkPhysicalDeviceProperties* pProperties) {
+    *pProperties = VkPhysicalDeviceProperties{};
+    pProperties->deviceType = VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+    std::strncpy(pProperties->deviceName, "Fake device", sizeof(pProperties->deviceName) - 1);
+    pProperties->limits.bufferImageGranularity = bufferImageGranularity;
+    pProperties->limits.minUniformBufferOffsetAlignment = 256;
+    pProperties->limits.minStorageBufferOffsetAlignment = 32;
+    pProperties->limits.nonCoherentAtomSize = 64;
+    pProperties->limits.optimalBufferCopyOffsetAlignment = 1;
+    pProperties->limits.maxMemoryAllocationCount = maxAllocationCount;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice,
+                                                               VkPhysicalDeviceMemoryProperties* pMemoryProperties) {
+    *pMemoryProperties = fakeMemoryProperties;
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice, const char*) {
+    /* No extension is exposed, the memory manager falls back to the core paths */
+    return nullptr;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(VkDevice, const VkMemoryAllocateInfo* pAllocateInfo,
+                                                const VkAllocationCallbacks*, VkDeviceMemory* pMemory) {
+    if (pAllocateInfo->memoryTypeIndex >= fakeMemoryProperties.memoryTypeCount) {
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+    uint32_t heapIndex = fakeMemoryProperties.memoryTypes[pAllocateInfo->memoryTypeIndex].heapIndex;
+
+    std::lock_guard<std::mutex> lock(fakeMutex);
+    if (heapAllocatedBytes[heapIndex] + pAllocateInfo->allocationSize > fakeMemoryProperties.memoryHeaps[heapIndex].size ||
+        fakeStatistics.liveAllocationCount >= maxAllocationCount) {
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    FakeMemory* memory = new FakeMemory{pAllocateInfo->allocationSize, heapIndex, nullptr};
+    *pMemory = reinterpret_cast<VkDeviceMemory>(memory);
+
+    heapAllocatedBytes[heapIndex] += memory->size;
+    fakeStatistics.allocatedBytes += memory->size;
+    fakeStatistics.peakAllocatedBytes = std::max(fakeStatistics.peakAllocatedBytes, fakeStatistics.allocatedBytes);
+    fakeStatistics.allocationCount++;
+    fakeStatistics.liveAllocationCount++;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*) {
+    if (memory == VK_NULL_HANDLE) {
+        return;
+    }
+    FakeMemory* fakeMemory = reinterpret_cast<FakeMemory*>(memory);
+
+    std::lock_guard<std::mutex> lock(fakeMutex);
+    heapAllocatedBytes[fakeMemory->heapIndex] -= fakeMemory->size;
+    fakeStatistics.allocatedBytes -= fakeMemory->size;
+    fakeStatistics.liveAllocationCount--;
+    delete fakeMemory;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkMapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset,
+                                           VkDeviceSize, VkMemoryMapFlags, void** ppData) {
+    FakeMemory* fakeMemory = reinterpret_cast<FakeMemory*>(memory);
+    if (!fakeMemory->data) {
+        /* Left uninitialised so that the pages are only committed once written */
+        fakeMemory->data.reset(new uint8_t[fakeMemory->size]);
+    }
+    *ppData = fakeMemory->data.get() + offset;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUnmapMemory(VkDevice, VkDeviceMemory) {
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateBuffer(VkDevice, const VkBufferCreateInfo* pCreateInfo,
+                                              const VkAllocationCallbacks*, VkBuffer* pBuffer) {
+    *pBuffer = reinterpret_cast<VkBuffer>(new FakeBuffer{pCreateInfo->size});
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyBuffer(VkDevice, VkBuffer buffer, const VkAllocationCallbacks*) {
+    delete reinterpret_cast<FakeBuffer*>(buffer);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImage(VkDevice, const VkImageCreateInfo* pCreateInfo,
+                                             const VkAllocationCallbacks*, VkImage* pImage) {
+    *pImage = reinterpret_cast<VkImage>(new FakeImage{pCreateInfo->tiling});
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImage(VkDevice, VkImage image, const VkAllocationCallbacks*) {
+    delete reinterpret_cast<FakeImage*>(image);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetBufferMemoryRequirements(VkDevice, VkBuffer buffer,
+                                                         VkMemoryRequirements* pMemoryRequirements) {
+    pMemoryRequirements->size = (reinterpret_cast<FakeBuffer*>(buffer)->size + 15) / 16 * 16;
+    pMemoryRequirements->alignment = 256;
+    pMemoryRequirements->memoryTypeBits = (1u << fakeMemoryProperties.memoryTypeCount) - 1;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindBufferMemory(VkDevice, VkBuffer, VkDeviceMemory,
+                                                  VkDeviceSize) {
+    std::lock_guard<std::mutex> lock(fakeMutex);
+    fakeStatistics.bindCount++;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindImageMemory(VkDevice, VkImage, VkDeviceMemory,
+                                                 VkDeviceSize) {
+    std::lock_guard<std::mutex> lock(fakeMutex);
+    fakeStatistics.bindCount++;
+    return VK_SUCCESS;
+}
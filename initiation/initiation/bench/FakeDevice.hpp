@@ -0,0 +1,33 @@
+#ifndef FAKE_DEVICE
+#define FAKE_DEVICE
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+struct FakeDeviceStatistics {
+    VkDeviceSize allocatedBytes{0};         /* Device memory currently allocated */
+    VkDeviceSize peakAllocatedBytes{0};     /* Footprint of the allocator */
+    uint32_t allocationCount{0};            /* vkAllocateMemory calls since the last reset */
+    uint32_t liveAllocationCount{0};
+    uint32_t bindCount{0};
+};
+
+/**
+ * CPU-only implementation of the Vulkan entry points used by the memory code,
+ * so that Chunk and MemoryManager can be measured without a GPU.
+ *
+ * Device memory is never touched unless it is mapped, and the physical device
+ * looks like a discrete GPU: a device local heap, a host heap and a small
+ * host visible device local heap.
+ */
+class FakeDevice {
+    public:
+        static void reset();
+        static FakeDeviceStatistics getStatistics();
+
+        static void setBufferImageGranularity(VkDeviceSize granularity);
+        static VkDeviceSize getBufferImageGranularity();
+};
+
+#endif
@@ -0,0 +1,464 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+
+#include <vulkan/vulkan.h>
+
+#include "FakeDevice.hpp"
+
+#include "memory/MemoryManager.hpp"
+#include "memory/BuddyChunk.hpp"
+#include "memory/TlsfChunk.hpp"
+#include "memory/AllocationTrace.hpp"
+
+#include "utils.hpp"
+
+/**
+ * Replays allocation traces against a single chunk and against the memory
+ * manager running on the fake device, and reports the cost of an operation,
+ * the fragmentation when the most memory was in use and the peak footprint.
+ *
+ * Usage: bench [trace file]...
+ * Without argument only the synthetic traces are replayed. Debug builds of the
+ * application record their allocations to resources/allocation.trace.
+ */
+
+struct Trace {
+    std::string name;
+    std::vector<TraceEvent> events;
+};
+
+struct BenchResult {
+    size_t operations{0};
+    size_t failures{0};
+    double nanoseconds{0.0};
+    VkDeviceSize peakRequestedBytes{0};     /* Live bytes at the sampled peak */
+    VkDeviceSize peakFootprint{0};          /* Chunk: peak used bytes, manager: peak device memory */
+    VkDeviceSize internalFragmentation{0};  /* At the sampled peak */
+    float externalFragmentation{0.0f};      /* At the sampled peak */
+    uint32_t deviceAllocationCount{0};
+};
+
+class Replayer {
+    public:
+        virtual ~Replayer() = default;
+
+        virtual bool allocate(const TraceEvent& event) = 0;
+        virtual void free(uint64_t id) = 0;
+        virtual void beginFrame(uint32_t imageIndex) = 0;
+        virtual VkDeviceSize getRequestedBytes() = 0;
+
+        /* Outside of the timed section, called when the requested bytes reach a new peak */
+        virtual void sample(BenchResult& result) = 0;
+        virtual void finish(BenchResult& result) = 0;
+};
+
+/* A single chunk, frees are immediate and frames ignored */
+class ChunkReplayer : public Replayer {
+    public:
+        ChunkReplayer(std::unique_ptr<Chunk> chunk) : mChunk(std::move(chunk)) {
+        }
+
+        bool allocate(const TraceEvent& event) override {
+            AllocationResult result = mChunk->reserve(event.size, event.alignment);
+            if (!result.found) {
+                return false;
+            }
+            mBlocks[event.id] = result.block;
+            mPeakUsedBytes = std::max(mPeakUsedBytes, static_cast<VkDeviceSize>(mChunk->getUsedSize()));
+            return true;
+        }
+
+        void free(uint64_t id) override {
+            auto it = mBlocks.find(id);
+            if (it == mBlocks.end()) {
+                return;
+            }
+            mChunk->free(it->second);
+            mBlocks.erase(it);
+        }
+
+        void beginFrame(uint32_t) override {
+        }
+
+        VkDeviceSize getRequestedBytes() override {
+            return mChunk->getRequestedSize();
+        }
+
+        void sample(BenchResult& result) override {
+            result.peakRequestedBytes = mChunk->getRequestedSize();
+            result.internalFragmentation = mChunk->getInternalFragmentation();
+
+            std::vector<Block> freeBlocks;
+            mChunk->getFreeBlocks(freeBlocks);
+            VkDeviceSize freeBytes{0}, largestFreeBlock{0};
+            for (const Block& block : freeBlocks) {
+                freeBytes += block.size;
+                largestFreeBlock = std::max(largestFreeBlock, static_cast<VkDeviceSize>(block.size));
+            }
+            result.externalFragmentation = freeBytes == 0 ? 0.0f : 1.0f - static_cast<float>(largestFreeBlock) / freeBytes;
+        }
+
+        void finish(BenchResult& result) override {
+            result.peakFootprint = mPeakUsedBytes;
+            result.deviceAllocationCount = 1;
+        }
+
+    private:
+        std::unique_ptr<Chunk> mChunk;
+        std::unordered_map<uint64_t, Block> mBlocks;
+        VkDeviceSize mPeakUsedBytes{0};
+};
+
+/* The whole memory manager on the fake device, with deferred frees and frame cycling */
+class ManagerReplayer : public Replayer {
+    public:
+        ManagerReplayer(bool forceStrategy, AllocationStrategy strategy) : mManager(mPhysicalDevice, mDevice) {
+            FakeDevice::reset();
+
+            VkPhysicalDeviceMemoryProperties properties;
+            vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &properties);
+            for (uint32_t i{0};i < properties.memoryTypeCount && forceStrategy;++i) {
+                mManager.setAllocationStrategy(i, strategy);
+            }
+            mManager.init();
+        }
+
+        bool allocate(const TraceEvent& event) override {
+            VkMemoryRequirements memoryRequirements;
+            memoryRequirements.size = event.size;
+            memoryRequirements.alignment = event.alignment;
+            memoryRequirements.memoryTypeBits = ~0u;
+
+            Resource resource;
+            try {
+                if (event.image) {
+                    VkImageCreateInfo createInfo{};
+                    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                    createInfo.tiling = event.tiling == ResourceTiling::Optimal ? VK_IMAGE_TILING_OPTIMAL : VK_IMAGE_TILING_LINEAR;
+                    vkCreateImage(mDevice, &createInfo, nullptr, &resource.image);
+                    resource.handle = mManager.allocateForImage(resource.image, memoryRequirements, event.flags, "bench", createInfo.tiling);
+                } else {
+                    VkBufferCreateInfo createInfo{};
+                    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+                    createInfo.size = event.size;
+                    vkCreateBuffer(mDevice, &createInfo, nullptr, &resource.buffer);
+                    resource.handle = mManager.allocateForBuffer(resource.buffer, memoryRequirements, event.flags, "bench");
+                }
+            } catch (const std::runtime_error& error) {
+                vkDestroyBuffer(mDevice, resource.buffer, nullptr);
+                vkDestroyImage(mDevice, resource.image, nullptr);
+                return false;
+            }
+
+            resource.size = event.size;
+            mRequestedBytes += event.size;
+            mResources[event.id] = resource;
+            return true;
+        }
+
+        void free(uint64_t id) override {
+            auto it = mResources.find(id);
+            if (it == mResources.end()) {
+                return;
+            }
+            mManager.freeAllocation(it->second.handle);
+            mRequestedBytes -= it->second.size;
+            mResources.erase(it);
+        }
+
+        void beginFrame(uint32_t imageIndex) override {
+            mManager.beginFrame(imageIndex);
+        }
+
+        VkDeviceSize getRequestedBytes() override {
+            return mRequestedBytes;
+        }
+
+        void sample(BenchResult& result) override {
+            MemoryStatistics statistics = mManager.queryStatistics();
+            result.peakRequestedBytes = mRequestedBytes;
+            result.internalFragmentation = statistics.total.internalFragmentation;
+            result.externalFragmentation = statistics.total.externalFragmentation;
+        }
+
+        void finish(BenchResult& result) override {
+            for (auto& pair : mResources) {
+                mManager.freeAllocation(pair.second.handle);
+            }
+            mResources.clear();
+            mManager.flushDeferredReleases();
+            mManager.cleanup();
+
+            FakeDeviceStatistics statistics = FakeDevice::getStatistics();
+            result.peakFootprint = statistics.peakAllocatedBytes;
+            result.deviceAllocationCount = statistics.allocationCount;
+        }
+
+    private:
+        struct Resource {
+            AllocationHandle handle;
+            VkBuffer buffer{VK_NULL_HANDLE};
+            VkImage image{VK_NULL_HANDLE};
+            VkDeviceSize size{0};
+        };
+
+        VkPhysicalDevice mPhysicalDevice{VK_NULL_HANDLE};
+        VkDevice mDevice{VK_NULL_HANDLE};
+        MemoryManager mManager;
+        std::unordered_map<uint64_t, Resource> mResources;
+        VkDeviceSize mRequestedBytes{0};
+};
+
+BenchResult replay(Replayer& replayer, const Trace& trace) {
+    using Clock = std::chrono::steady_clock;
+
+    BenchResult result;
+    VkDeviceSize peakRequestedBytes{0};
+    Clock::duration elapsed{0};
+    Clock::time_point start = Clock::now();
+
+    for (const TraceEvent& event : trace.events) {
+        switch (event.type) {
+            case TraceEventType::Allocation:
+                if (!replayer.allocate(event)) {
+                    result.failures++;
+                }
+                result.operations++;
+                break;
+            case TraceEventType::Free:
+                replayer.free(event.id);
+                result.operations++;
+                break;
+            case TraceEventType::Frame:
+                replayer.beginFrame(event.imageIndex);
+
+                /* Sampling walks every chunk, keep it out of the measure */
+                if (replayer.getRequestedBytes() > peakRequestedBytes) {
+                    elapsed += Clock::now() - start;
+                    peakRequestedBytes = replayer.getRequestedBytes();
+                    replayer.sample(result);
+                    start = Clock::now();
+                }
+                break;
+        }
+    }
+    elapsed += Clock::now() - start;
+
+    result.nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    replayer.finish(result);
+    return result;
+}
+
+/* Sizes spread evenly over the powers of two, as resource sizes are */
+VkDeviceSize randomSize(std::mt19937_64& random, VkDeviceSize minimum, VkDeviceSize maximum) {
+    std::uniform_real_distribution<double> exponent(std::log2(static_cast<double>(minimum)), std::log2(static_cast<double>(maximum)));
+    return static_cast<VkDeviceSize>(std::exp2(exponent(random)));
+}
+
+TraceEvent makeAllocation(uint64_t id, VkDeviceSize size, VkMemoryPropertyFlags flags, bool image = false) {
+    TraceEvent event;
+    event.type = TraceEventType::Allocation;
+    event.id = id;
+    event.size = size;
+    event.flags = flags;
+    event.image = image;
+    event.tiling = image ? ResourceTiling::Optimal : ResourceTiling::Linear;
+    event.alignment = image ? (size >= mega ? 64 * kilo : 4 * kilo) : 256;
+    return event;
+}
+
+TraceEvent makeFree(uint64_t id) {
+    TraceEvent event;
+    event.type = TraceEventType::Free;
+    event.id = id;
+    return event;
+}
+
+TraceEvent makeFrame(uint32_t frame) {
+    TraceEvent event;
+    event.type = TraceEventType::Frame;
+    event.imageIndex = frame % 3;
+    return event;
+}
+
+/* A steady live set where every operation replaces a random allocation */
+Trace makeChurnTrace() {
+    Trace trace{"churn", {}};
+    std::mt19937_64 random(1);
+    std::vector<uint64_t> live;
+    uint64_t nextId{0};
+
+    for (size_t i{0};i < 4096;++i) {
+        live.push_back(nextId);
+        trace.events.push_back(makeAllocation(nextId++, randomSize(random, 256, 64 * kilo), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+    }
+
+    for (uint32_t i{0};i < 100000;++i) {
+        size_t index = std::uniform_int_distribution<size_t>(0, live.size() - 1)(random);
+        trace.events.push_back(makeFree(live[index]));
+        live[index] = nextId;
+        trace.events.push_back(makeAllocation(nextId++, randomSize(random, 256, 64 * kilo), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+
+        if (i % 64 == 0) {
+            trace.events.push_back(makeFrame(i / 64));
+        }
+    }
+    return trace;
+}
+
+/* Per-frame bursts of staging and uniform data freed two frames later, over a slowly growing resident set */
+Trace makeBurstyTrace() {
+    Trace trace{"bursty", {}};
+    std::mt19937_64 random(2);
+    std::vector<std::vector<uint64_t>> bursts(3);
+    uint64_t nextId{0};
+    const VkMemoryPropertyFlags hostFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    for (uint32_t frame{0};frame < 300;++frame) {
+        std::vector<uint64_t>& burst = bursts[frame % 3];
+        for (uint64_t id : burst) {
+            trace.events.push_back(makeFree(id));
+        }
+        burst.clear();
+
+        size_t burstSize = frame % 30 == 0 ? 2000 : std::uniform_int_distribution<size_t>(50, 300)(random);
+        for (size_t i{0};i < burstSize;++i) {
+            burst.push_back(nextId);
+            trace.events.push_back(makeAllocation(nextId++, randomSize(random, 64, 256 * kilo), hostFlags));
+        }
+
+        for (size_t i{0};i < 2;++i) {
+            trace.events.push_back(makeAllocation(nextId++, randomSize(random, 4 * kilo, 256 * kilo), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+        }
+
+        trace.events.push_back(makeFrame(frame));
+    }
+    return trace;
+}
+
+/* Mostly small buffers, some meshes and a few large images, with short and long lifetimes */
+Trace makeMixedTrace() {
+    Trace trace{"mixed", {}};
+    std::mt19937_64 random(3);
+    std::vector<std::vector<uint64_t>> expirations(64);
+    std::vector<uint64_t> longLived;
+    VkDeviceSize longLivedBytes{0};
+    uint64_t nextId{0};
+
+    for (uint32_t frame{0};frame < 6000;++frame) {
+        for (uint64_t id : expirations[frame % expirations.size()]) {
+            trace.events.push_back(makeFree(id));
+        }
+        expirations[frame % expirations.size()].clear();
+
+        for (size_t i{0};i < 16;++i) {
+            float kind = std::uniform_real_distribution<float>(0.0f, 1.0f)(random);
+            TraceEvent event;
+            if (kind < 0.7f) {
+                event = makeAllocation(nextId++, randomSize(random, 64, 4 * kilo), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            } else if (kind < 0.95f) {
+                event = makeAllocation(nextId++, randomSize(random, 16 * kilo, mega), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            } else {
+                event = makeAllocation(nextId++, randomSize(random, 64 * kilo, 8 * mega), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+            }
+            trace.events.push_back(event);
+
+            /* One in ten outlives the trace until the long-lived set gets too big for a single chunk */
+            if (std::uniform_int_distribution<int>(0, 9)(random) == 0 && longLivedBytes + event.size < 48 * mega) {
+                longLived.push_back(event.id);
+                longLivedBytes += event.size;
+            } else {
+                size_t lifetime = std::uniform_int_distribution<size_t>(1, expirations.size() - 1)(random);
+                expirations[(frame + lifetime) % expirations.size()].push_back(event.id);
+            }
+        }
+
+        trace.events.push_back(makeFrame(frame));
+    }
+    return trace;
+}
+
+std::string toMegabytes(VkDeviceSize bytes) {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(2) << static_cast<double>(bytes) / mega << " MB";
+    return stream.str();
+}
+
+void printHeader() {
+    std::cout << std::left << std::setw(10) << "trace" << std::setw(16) << "allocator"
+              << std::right << std::setw(10) << "ops" << std::setw(10) << "ns/op" << std::setw(10) << "failures"
+              << std::setw(14) << "peak live" << std::setw(14) << "footprint" << std::setw(14) << "internal"
+              << std::setw(10) << "external" << std::setw(10) << "chunks" << std::endl;
+}
+
+void printResult(const std::string& trace, const std::string& allocator, const BenchResult& result) {
+    double nanosecondsPerOperation = result.operations == 0 ? 0.0 : result.nanoseconds / result.operations;
+    std::cout << std::left << std::setw(10) << trace << std::setw(16) << allocator
+              << std::right << std::setw(10) << result.operations
+              << std::setw(10) << std::fixed << std::setprecision(1) << nanosecondsPerOperation
+              << std::setw(10) << result.failures
+              << std::setw(14) << toMegabytes(result.peakRequestedBytes)
+              << std::setw(14) << toMegabytes(result.peakFootprint)
+              << std::setw(14) << toMegabytes(result.internalFragmentation)
+              << std::setw(9) << std::setprecision(1) << result.externalFragmentation * 100.0f << "%"
+              << std::setw(10) << result.deviceAllocationCount << std::endl;
+}
+
+void run(const Trace& trace) {
+    const VkDeviceSize chunkSize = 256 * mega;
+    {
+        ChunkReplayer replayer(std::make_unique<BuddyChunk>(VK_NULL_HANDLE, chunkSize));
+        printResult(trace.name, "buddy chunk", replay(replayer, trace));
+    }
+    {
+        ChunkReplayer replayer(std::make_unique<TlsfChunk>(VK_NULL_HANDLE, chunkSize));
+        printResult(trace.name, "tlsf chunk", replay(replayer, trace));
+    }
+    {
+        ManagerReplayer replayer(false, AllocationStrategy::Tlsf);
+        printResult(trace.name, "manager", replay(replayer, trace));
+    }
+    {
+        ManagerReplayer replayer(true, AllocationStrategy::Buddy);
+        printResult(trace.name, "manager buddy", replay(replayer, trace));
+    }
+    {
+        ManagerReplayer replayer(true, AllocationStrategy::Tlsf);
+        printResult(trace.name, "manager tlsf", replay(replayer, trace));
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<Trace> traces{makeChurnTrace(), makeBurstyTrace(), makeMixedTrace()};
+    for (int i{1};i < argc;++i) {
+        Trace trace{argv[i], {}};
+        if (!AllocationTrace::load(argv[i], trace.events)) {
+            std::cerr << "Failed to open " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+        traces.push_back(std::move(trace));
+    }
+
+    printHeader();
+    for (const Trace& trace : traces) {
+        try {
+            run(trace);
+        } catch (const std::exception& e) {
+            std::cerr << trace.name << ": " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -92,6 +92,12 @@ void HelloTriangleApplication::init() {
     mCamera.setExtent({WIDTH, HEIGHT});
     mCamera.setFov(70);
     
+    /* Pre-allocate what the previous run needed, and record what this one needs */
+    mContext.getMemoryManager().setAllocationProfile(std::string(ROOT_PATH) + std::string("resources/allocation.profile"));
+    #ifdef DEBUG
+        /* Replayed by the allocator benchmark */
+        mContext.getMemoryManager().setAllocationTrace(std::string(ROOT_PATH) + std::string("resources/allocation.trace"));
+    #endif
     mContext.create(mWindow);
 
     mLight = {{20.0, 20.0, 20.0}};
@@ -102,13 +108,14 @@ void HelloTriangleApplication::init() {
     mTextureManager.load("undefined", std::string(ROOT_PATH) + std::string("resources/textures/undefined.png"));
     mTextureManager.load("cottage_diffuse", std::string(ROOT_PATH) + std::string("resources/textures/cottage_diffuse.png"));
 
-    mMeshManager.create(mContext);
+    mMeshManager.create(mContext, mTextureManager);
 
     mRenderer.create(mContext, mTextureManager, mMeshManager);
     mRenderer.setCamera(mCamera);
     mRenderer.setLight(mLight);
 
     mMeshManager.setImageCount(mRenderer.getSwapChain().getImageCount());
+    mTextureManager.setImageCount(mRenderer.getSwapChain().getImageCount());
 
     mDeer = mImporter.loadMesh("cottage.fbx");
     mDeer.setTexture(mTextureManager.getTexture("cottage_diffuse"));
@@ -143,12 +150,13 @@ void HelloTriangleApplication::processInputs() {
     }
 
     if (glfwGetKey(mWindow, GLFW_KEY_SPACE) && !mTempKeyState) {
-        mMeshes.push_back(std::make_unique<Mesh>(std::move(MeshHelper::createCube(1.0))));
+        /* The cubes share the geometry of the first one */
+        mInstances.push_back(std::make_unique<MeshInstance>(*mTemp));
 
-        Mesh* temp = mMeshes.back().get();
+        MeshInstance* temp = mInstances.back().get();
         temp->setTexture(mTextureManager.getTexture("diamond"));
         temp->getTransform().setPosition({mTempCounter, mTempCounter, mTempCounter});
-        mMeshManager.addMesh(*temp);
+        mMeshManager.addInstance(*temp);
         mTempCounter += 1.0f;
         mTempKeyState = true;
     } else if (!glfwGetKey(mWindow, GLFW_KEY_SPACE)){
@@ -0,0 +1,37 @@
+#include "memory/AllocationNames.hpp"
+
+#include <algorithm>
+
+uint32_t AllocationNames::intern(const std::string& name) {
+    auto it = mIds.find(name);
+    if (it != mIds.end()) {
+        return it->second;
+    }
+
+    uint32_t nameId = static_cast<uint32_t>(mUsages.size());
+    mIds.emplace(name, nameId);
+    mUsages.push_back({name});
+    return nameId;
+}
+
+const std::string& AllocationNames::getName(uint32_t nameId) const {
+    return mUsages[nameId].name;
+}
+
+void AllocationNames::add(uint32_t nameId, VkDeviceSize size) {
+    NamedUsage& usage = mUsages[nameId];
+    usage.liveBytes += size;
+    usage.peakBytes = std::max(usage.peakBytes, usage.liveBytes);
+    usage.liveCount++;
+    usage.totalCount++;
+}
+
+void AllocationNames::remove(uint32_t nameId, VkDeviceSize size) {
+    NamedUsage& usage = mUsages[nameId];
+    usage.liveBytes -= size;
+    usage.liveCount--;
+}
+
+const std::vector<NamedUsage>& AllocationNames::getUsages() const {
+    return mUsages;
+}
@@ -0,0 +1,73 @@
+#include "memory/AllocationProfile.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+bool AllocationProfile::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string keyword;
+        uint32_t memoryTypeIndex;
+        if (!(stream >> keyword >> memoryTypeIndex) || keyword != "type" || memoryTypeIndex >= VK_MAX_MEMORY_TYPES) {
+            continue;
+        }
+
+        MemoryTypeProfile profile;
+        size_t chunkCount;
+        if (!(stream >> profile.flags >> keyword >> chunkCount) || keyword != "chunks") {
+            continue;
+        }
+
+        bool valid{true};
+        for (size_t i{0};i < chunkCount && valid;++i) {
+            ProfiledChunk chunk;
+            std::string tiling;
+            valid = static_cast<bool>(stream >> chunk.size >> tiling);
+            chunk.tiling = tiling == "optimal" ? ResourceTiling::Optimal : ResourceTiling::Linear;
+            profile.chunks.push_back(chunk);
+            profile.peakReservedBytes += chunk.size;
+        }
+
+        valid = valid && (stream >> keyword) && keyword == "slabs";
+        for (uint32_t i{0};i < SlabAllocator::SizeClassCount && valid;++i) {
+            valid = static_cast<bool>(stream >> profile.slabCounts[i]);
+        }
+
+        /* A truncated line is ignored rather than half applied */
+        if (valid) {
+            types[memoryTypeIndex] = profile;
+        }
+    }
+    return true;
+}
+
+void AllocationProfile::save(const std::string& filename, uint32_t memoryTypeCount) const {
+    std::ofstream file(filename, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + filename);
+    }
+
+    for (uint32_t i{0};i < memoryTypeCount;++i) {
+        const MemoryTypeProfile& profile = types[i];
+        if (profile.chunks.empty()) {
+            continue;
+        }
+
+        file << "type " << i << " " << profile.flags << " chunks " << profile.chunks.size();
+        for (const ProfiledChunk& chunk : profile.chunks) {
+            file << " " << chunk.size << " " << (chunk.tiling == ResourceTiling::Optimal ? "optimal" : "linear");
+        }
+        file << " slabs";
+        for (uint32_t count : profile.slabCounts) {
+            file << " " << count;
+        }
+        file << "\n";
+    }
+}
@@ -0,0 +1,61 @@
+#include "memory/AllocationTable.hpp"
+
+#include <stdexcept>
+
+AllocationHandle AllocationTable::insert(const AllocationRecord& record) {
+    uint32_t index;
+    if (!mFreeSlots.empty()) {
+        index = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    } else {
+        index = static_cast<uint32_t>(mSlots.size());
+        mSlots.emplace_back();
+    }
+
+    Slot& slot = mSlots[index];
+    slot.record = record;
+    slot.generation++;
+    slot.used = true;
+    mSize++;
+
+    return AllocationHandle{index, slot.generation};
+}
+
+void AllocationTable::erase(AllocationHandle handle) {
+    if (!contains(handle)) {
+        throw std::runtime_error("Trying to free an invalid allocation handle");
+    }
+
+    mSlots[handle.index].used = false;
+    mFreeSlots.push_back(handle.index);
+    mSize--;
+}
+
+bool AllocationTable::contains(AllocationHandle handle) const {
+    return handle.index < mSlots.size() && mSlots[handle.index].used &&
+           mSlots[handle.index].generation == handle.generation;
+}
+
+AllocationRecord& AllocationTable::get(AllocationHandle handle) {
+    if (!contains(handle)) {
+        throw std::runtime_error("Trying to access an invalid allocation handle");
+    }
+    return mSlots[handle.index].record;
+}
+
+const AllocationRecord& AllocationTable::get(AllocationHandle handle) const {
+    if (!contains(handle)) {
+        throw std::runtime_error("Trying to access an invalid allocation handle");
+    }
+    return mSlots[handle.index].record;
+}
+
+size_t AllocationTable::size() const {
+    return mSize;
+}
+
+void AllocationTable::clear() {
+    mSlots.clear();
+    mFreeSlots.clear();
+    mSize = 0;
+}
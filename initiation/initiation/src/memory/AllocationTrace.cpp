@@ -0,0 +1,88 @@
+#include "memory/AllocationTrace.hpp"
+
+#include <sstream>
+
+bool AllocationTrace::open(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFile.open(filename, std::ios::out | std::ios::trunc);
+    return mFile.is_open();
+}
+
+bool AllocationTrace::isOpen() const {
+    return mFile.is_open();
+}
+
+void AllocationTrace::close() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile.is_open()) {
+        mFile.close();
+    }
+}
+
+void AllocationTrace::recordAllocation(AllocationHandle handle, const VkMemoryRequirements& memoryRequirements,
+                                       VkMemoryPropertyFlags flags, bool image, ResourceTiling tiling) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mFile.is_open()) {
+        return;
+    }
+
+    mFile << "alloc " << getId(handle) << " " << memoryRequirements.size << " " << memoryRequirements.alignment << " "
+          << flags << " " << (image ? "image" : "buffer") << " "
+          << (tiling == ResourceTiling::Optimal ? "optimal" : "linear") << "\n";
+}
+
+void AllocationTrace::recordFree(AllocationHandle handle) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile.is_open()) {
+        mFile << "free " << getId(handle) << "\n";
+    }
+}
+
+void AllocationTrace::recordFrame(uint32_t imageIndex) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFile.is_open()) {
+        mFile << "frame " << imageIndex << "\n";
+    }
+}
+
+bool AllocationTrace::load(const std::string& filename, std::vector<TraceEvent>& events) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string keyword;
+        if (!(stream >> keyword)) {
+            continue;
+        }
+
+        TraceEvent event;
+        bool valid{false};
+        if (keyword == "alloc") {
+            std::string resource, tiling;
+            event.type = TraceEventType::Allocation;
+            valid = static_cast<bool>(stream >> event.id >> event.size >> event.alignment >> event.flags >> resource >> tiling);
+            event.image = resource == "image";
+            event.tiling = tiling == "optimal" ? ResourceTiling::Optimal : ResourceTiling::Linear;
+        } else if (keyword == "free") {
+            event.type = TraceEventType::Free;
+            valid = static_cast<bool>(stream >> event.id);
+        } else if (keyword == "frame") {
+            event.type = TraceEventType::Frame;
+            valid = static_cast<bool>(stream >> event.imageIndex);
+        }
+
+        /* A truncated last line (the run crashed) is ignored */
+        if (valid) {
+            events.push_back(event);
+        }
+    }
+    return true;
+}
+
+uint64_t AllocationTrace::getId(AllocationHandle handle) {
+    return (static_cast<uint64_t>(handle.generation) << 32) | handle.index;
+}
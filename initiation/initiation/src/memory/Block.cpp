@@ -1,14 +1,16 @@
 #include "memory/Block.hpp"
 
+#include <stdexcept>
+
 Block::Block(const size_t blockSize, const size_t blockOffset) {
-    if (!isPowerOfTwo(blockSize)) {
-        throw std::runtime_error("Error ! 'blockSize' must be a power of two.");
-    }
     size = blockSize;
     offset = blockOffset;
 }
 
 std::tuple<Block, Block> Block::divide() {
+    if (!isPowerOfTwo(size)) {
+        throw std::runtime_error("Error ! Only blocks with a power of two size can be divided.");
+    }
     size_t newSize = size >> 1;
     return std::make_tuple<Block, Block>({newSize, offset}, {newSize, offset + newSize});
 }
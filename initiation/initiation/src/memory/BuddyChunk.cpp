@@ -0,0 +1,207 @@
+#include "memory/BuddyChunk.hpp"
+
+#include <stdexcept>
+
+size_t BuddyChunk::MinBlockSize = 4 * 1024;
+
+BuddyChunk::BuddyChunk(VkDeviceMemory memory, const size_t chunkSize, const size_t minBlockSize) :
+    Chunk(memory, chunkSize), mMinBlockSize(minBlockSize) {
+    if (!Block::isPowerOfTwo(chunkSize) || !Block::isPowerOfTwo(minBlockSize) || minBlockSize > chunkSize) {
+        throw std::runtime_error("Error ! 'chunkSize' and 'minBlockSize' must be powers of two with minBlockSize <= chunkSize.");
+    }
+    build(minBlockSize);
+}
+
+AllocationResult BuddyChunk::reserve(const size_t blockSize, const size_t alignment) {
+    AllocationResult result;
+    result.found = false;
+
+    if (blockSize > mSize || alignment > mSize) {
+        return result;
+    }
+
+    /* Blocks are aligned on their size, so a big enough block satisfies any alignment */
+    size_t realBlockSize = mMinBlockSize;
+    while (realBlockSize < blockSize || realBlockSize < alignment) {
+        realBlockSize <<= 1;
+    }
+
+    uint32_t order = getOrder(realBlockSize);
+
+    /* Find the smallest order that has a free block */
+    uint32_t currentOrder = order;
+    while (currentOrder < mOrderCount && mFreeListHeads[currentOrder] == InvalidIndex) {
+        currentOrder++;
+    }
+
+    if (currentOrder == mOrderCount) {
+        return result;
+    }
+
+    uint32_t leafIndex = popFree(currentOrder);
+
+    /* Split it until it has the requested size, the right halves become free */
+    while (currentOrder > order) {
+        currentOrder--;
+        pushFree(currentOrder, leafIndex + (1u << currentOrder));
+    }
+
+    setBit(mAllocatedBits, getBitIndex(order, leafIndex));
+
+    result.found = true;
+    result.block = Block(realBlockSize, static_cast<size_t>(leafIndex) * mLeafSize);
+    result.block.requestedSize = blockSize;
+    result.block.free = false;
+
+    mUsedSize += realBlockSize;
+    mRequestedSize += blockSize;
+    return result;
+}
+
+bool BuddyChunk::free(Block block) {
+    if (block.size < mLeafSize || block.size > mSize || !Block::isPowerOfTwo(block.size) ||
+        block.offset % block.size != 0 || block.offset >= mSize) {
+        return false;
+    }
+
+    uint32_t order = getOrder(block.size);
+    uint32_t leafIndex = static_cast<uint32_t>(block.offset / mLeafSize);
+
+    size_t bitIndex = getBitIndex(order, leafIndex);
+    if (!testBit(mAllocatedBits, bitIndex)) {
+        return false;
+    }
+    clearBit(mAllocatedBits, bitIndex);
+
+    mUsedSize -= block.size;
+    mRequestedSize -= block.requestedSize;
+
+    /* Merge with the buddy as long as it is free */
+    while (order + 1 < mOrderCount) {
+        uint32_t buddyIndex = leafIndex ^ (1u << order);
+        if (!testBit(mFreeBits, getBitIndex(order, buddyIndex))) {
+            break;
+        }
+        removeFree(order, buddyIndex);
+        leafIndex &= ~(1u << order);
+        order++;
+    }
+
+    pushFree(order, leafIndex);
+    return true;
+}
+
+AllocationStrategy BuddyChunk::getStrategy() const {
+    return AllocationStrategy::Buddy;
+}
+
+void BuddyChunk::getFreeBlocks(std::vector<Block>& freeBlocks) const {
+    for (uint32_t order{0};order < mOrderCount;++order) {
+        for (uint32_t leafIndex = mFreeListHeads[order];leafIndex != InvalidIndex;leafIndex = mNext[leafIndex]) {
+            freeBlocks.push_back(Block(mLeafSize << order, static_cast<size_t>(leafIndex) * mLeafSize));
+        }
+    }
+}
+
+void BuddyChunk::setMinBlockSize(const size_t minBlockSize) {
+    if (!Block::isPowerOfTwo(minBlockSize) || minBlockSize > mSize) {
+        throw std::runtime_error("Error ! 'minBlockSize' must be a power of two lower than the chunk size.");
+    }
+
+    if (minBlockSize >= mLeafSize) {
+        mMinBlockSize = minBlockSize;
+        return;
+    }
+
+    /* A smaller leaf size changes the whole layout, only possible while nothing is reserved */
+    if (mFreeListHeads[mOrderCount - 1] == InvalidIndex) {
+        throw std::runtime_error("Error ! Can't lower the minimum block size of a chunk in use.");
+    }
+    mMinBlockSize = minBlockSize;
+    build(minBlockSize);
+}
+
+void BuddyChunk::build(const size_t leafSize) {
+    mLeafSize = leafSize;
+
+    size_t leafCount = mSize / mLeafSize;
+    mOrderCount = 1;
+    while ((mLeafSize << (mOrderCount - 1)) < mSize) {
+        mOrderCount++;
+    }
+
+    mBitOffsets.resize(mOrderCount);
+    size_t bitCount{0};
+    for (uint32_t order{0};order < mOrderCount;++order) {
+        mBitOffsets[order] = bitCount;
+        bitCount += leafCount >> order;
+    }
+
+    mFreeListHeads.assign(mOrderCount, InvalidIndex);
+    mNext.assign(leafCount, InvalidIndex);
+    mPrevious.assign(leafCount, InvalidIndex);
+    mFreeBits.assign((bitCount + 63) / 64, 0);
+    mAllocatedBits.assign((bitCount + 63) / 64, 0);
+
+    pushFree(mOrderCount - 1, 0);
+}
+
+uint32_t BuddyChunk::getOrder(const size_t blockSize) const {
+    uint32_t order{0};
+    while ((mLeafSize << order) < blockSize) {
+        order++;
+    }
+    return order;
+}
+
+size_t BuddyChunk::getBitIndex(const uint32_t order, const uint32_t leafIndex) const {
+    return mBitOffsets[order] + (leafIndex >> order);
+}
+
+void BuddyChunk::pushFree(const uint32_t order, const uint32_t leafIndex) {
+    uint32_t head = mFreeListHeads[order];
+    mNext[leafIndex] = head;
+    mPrevious[leafIndex] = InvalidIndex;
+    if (head != InvalidIndex) {
+        mPrevious[head] = leafIndex;
+    }
+    mFreeListHeads[order] = leafIndex;
+    setBit(mFreeBits, getBitIndex(order, leafIndex));
+}
+
+uint32_t BuddyChunk::popFree(const uint32_t order) {
+    uint32_t leafIndex = mFreeListHeads[order];
+    removeFree(order, leafIndex);
+    return leafIndex;
+}
+
+void BuddyChunk::removeFree(const uint32_t order, const uint32_t leafIndex) {
+    uint32_t next = mNext[leafIndex];
+    uint32_t previous = mPrevious[leafIndex];
+
+    if (previous != InvalidIndex) {
+        mNext[previous] = next;
+    } else {
+        mFreeListHeads[order] = next;
+    }
+
+    if (next != InvalidIndex) {
+        mPrevious[next] = previous;
+    }
+
+    mNext[leafIndex] = InvalidIndex;
+    mPrevious[leafIndex] = InvalidIndex;
+    clearBit(mFreeBits, getBitIndex(order, leafIndex));
+}
+
+bool BuddyChunk::testBit(const std::vector<uint64_t>& bits, const size_t index) {
+    return (bits[index >> 6] >> (index & 63)) & 1;
+}
+
+void BuddyChunk::setBit(std::vector<uint64_t>& bits, const size_t index) {
+    bits[index >> 6] |= (uint64_t(1) << (index & 63));
+}
+
+void BuddyChunk::clearBit(std::vector<uint64_t>& bits, const size_t index) {
+    bits[index >> 6] &= ~(uint64_t(1) << (index & 63));
+}
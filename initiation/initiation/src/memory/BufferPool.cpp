@@ -0,0 +1,194 @@
+#include "memory/BufferPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "memory/MemoryManager.hpp"
+#include "utils.hpp"
+
+VkDeviceSize BufferPool::DefaultBlockSize = 16 * mega;
+
+BufferPool::BufferPool(VkDevice& device, MemoryManager& memoryManager) :
+    mDevice(device), mMemoryManager(memoryManager) {
+}
+
+void BufferPool::create(VkBufferUsageFlags usage, MemoryUsage memoryUsage, VkDeviceSize alignment,
+                        const std::vector<uint32_t>& queueFamilyIndices, VkDeviceSize blockSize) {
+    /* The TLSF granularity doubles as the range alignment, so it must be a power of two */
+    VkDeviceSize granularity{16};
+    while (granularity < alignment) {
+        granularity *= 2;
+    }
+
+    mUsage = usage;
+    mMemoryUsage = memoryUsage;
+    mAlignment = granularity;
+    mBlockSize = (blockSize + granularity - 1) / granularity * granularity;
+    mQueueFamilyIndices = queueFamilyIndices;
+}
+
+void BufferPool::destroy() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (PoolBlock& block : mBlocks) {
+        destroyBlock(block);
+    }
+    mBlocks.clear();
+}
+
+BufferRange BufferPool::allocate(VkDeviceSize size) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    AllocationResult result;
+    result.found = false;
+
+    uint32_t blockIndex{0};
+    for (;blockIndex < mBlocks.size();++blockIndex) {
+        if (mBlocks[blockIndex].ranges) {
+            result = mBlocks[blockIndex].ranges->reserve(size, mAlignment);
+            if (result.found) {
+                break;
+            }
+        }
+    }
+
+    if (!result.found) {
+        blockIndex = createBlock(std::max(size, mBlockSize));
+        result = mBlocks[blockIndex].ranges->reserve(size, mAlignment);
+        if (!result.found) {
+            throw std::runtime_error("Unable to allocate a buffer range");
+        }
+    }
+
+    PoolBlock& block = mBlocks[blockIndex];
+
+    BufferRange range;
+    range.buffer = block.buffer;
+    range.offset = result.block.offset;
+    range.size = size;
+    range.data = block.data != nullptr ? block.data + range.offset : nullptr;
+    range.blockIndex = blockIndex;
+    range.block = result.block;
+    return range;
+}
+
+void BufferPool::free(const BufferRange& range) {
+    if (range.buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    /* The range may still be read by frames in flight */
+    mMemoryManager.releaseDeferred([this, range]() { release(range); });
+}
+
+void BufferPool::setMoveCallback(BufferMoveCallback onMove) {
+    /* A host visible range hands out a pointer to its memory, which would change as well */
+    if (mMemoryUsage != MemoryUsage::GpuOnly) {
+        throw std::runtime_error("Only the blocks of a device local pool can be moved");
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMoveCallback = onMove;
+    for (uint32_t i{0};i < mBlocks.size();++i) {
+        if (mBlocks[i].ranges) {
+            setBlockMovable(i);
+        }
+    }
+}
+
+void BufferPool::release(const BufferRange& range) {
+    /* The range may hold the buffer the block had before a move, the block index is what identifies it */
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (range.blockIndex >= mBlocks.size() || !mBlocks[range.blockIndex].ranges ||
+        !mBlocks[range.blockIndex].ranges->free(range.block)) {
+        throw std::runtime_error("Unable to find the buffer range to free");
+    }
+
+    /* Keep the first block around, the others go away as soon as they are empty */
+    PoolBlock& block = mBlocks[range.blockIndex];
+    if (range.blockIndex != 0 && block.ranges->getUsedSize() == 0) {
+        destroyBlock(block);
+    }
+}
+
+uint32_t BufferPool::createBlock(VkDeviceSize size) {
+    size = (size + mAlignment - 1) / mAlignment * mAlignment;
+
+    PoolBlock block;
+
+    VkBufferCreateInfo bufferInfo = getCreateInfo(size);
+    if (vkCreateBuffer(mDevice, &bufferInfo, nullptr, &block.buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pool buffer");
+    }
+
+    VkMemoryRequirements memoryRequirements{};
+    vkGetBufferMemoryRequirements(mDevice, block.buffer, &memoryRequirements);
+    block.allocation = mMemoryManager.allocateForBuffer(block.buffer, memoryRequirements, mMemoryUsage, "BufferPool");
+
+    if (mMemoryUsage != MemoryUsage::GpuOnly) {
+        block.data = static_cast<uint8_t*>(mMemoryManager.getMappedPointer(block.allocation));
+    }
+
+    block.ranges = std::make_unique<TlsfAllocator>(size, mAlignment);
+
+    /* Reuse the slot of a destroyed block so that the indices of the others stay valid */
+    uint32_t blockIndex{0};
+    while (blockIndex < mBlocks.size() && mBlocks[blockIndex].ranges) {
+        ++blockIndex;
+    }
+    if (blockIndex == mBlocks.size()) {
+        mBlocks.emplace_back();
+    }
+    mBlocks[blockIndex] = std::move(block);
+
+    if (mMoveCallback) {
+        setBlockMovable(blockIndex);
+    }
+    return blockIndex;
+}
+
+void BufferPool::destroyBlock(PoolBlock& block) {
+    if (!block.ranges) {
+        return;
+    }
+
+    /* Also destroys the buffer */
+    mMemoryManager.freeAllocation(block.allocation);
+    block.buffer = VK_NULL_HANDLE;
+    block.allocation = AllocationHandle();
+    block.ranges.reset();
+    block.data = nullptr;
+}
+
+VkBufferCreateInfo BufferPool::getCreateInfo(VkDeviceSize size) const {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = mUsage;
+    /* The ranges of a block are used by several queues at once, so no single queue can own it */
+    if (mQueueFamilyIndices.size() > 1) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(mQueueFamilyIndices.size());
+        bufferInfo.pQueueFamilyIndices = mQueueFamilyIndices.data();
+    } else {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+    return bufferInfo;
+}
+
+void BufferPool::setBlockMovable(uint32_t blockIndex) {
+    PoolBlock& block = mBlocks[blockIndex];
+    mMemoryManager.setBufferMovable(block.allocation, getCreateInfo(block.ranges->getSize()),
+        [this, blockIndex](VkBuffer oldBuffer, VkBuffer newBuffer) { moveBlock(blockIndex, oldBuffer, newBuffer); });
+}
+
+void BufferPool::moveBlock(uint32_t blockIndex, VkBuffer oldBuffer, VkBuffer newBuffer) {
+    BufferMoveCallback onMove;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBlocks[blockIndex].buffer = newBuffer;
+        onMove = mMoveCallback;
+    }
+
+    /* The ranges handed out hold the previous buffer, their owners switch to the new one */
+    onMove(oldBuffer, newBuffer);
+}
@@ -1,128 +1,48 @@
 #include "memory/Chunk.hpp"
 
-#include <cmath>
-
-size_t Chunk::MinBlockSize = 4 * 1024;
-
-Chunk::Chunk(VkDeviceMemory memory, const size_t chunkSize, const size_t minBlockSize) : mTree(Block(chunkSize)), mMinBlockSize(minBlockSize), mMemory(memory) {
+Chunk::Chunk(VkDeviceMemory memory, const size_t chunkSize) : mMemory(memory), mSize(chunkSize) {
 }
 
-AllocationResult Chunk::reserve(const size_t blockSize) {
-    int nextPowerOfTwo = (size_t)std::ceil(std::log2(blockSize));
-    int realBlockSize = (1 << nextPowerOfTwo) < mMinBlockSize ? mMinBlockSize : (1 << nextPowerOfTwo);
-
-    AllocationResult result = _reserve(realBlockSize, mTree);
-
-    return result;
+const VkDeviceMemory Chunk::getMemory() const {
+    return mMemory;
 }
 
-AllocationResult Chunk::_reserve(const size_t blockSize, BlockBinaryTree& memory) {
-    Block& currentBlock = memory.getValue();
-    AllocationResult result;
-
-    if (!currentBlock.free) {
-        result.found = false;
-        return result;
-    } else {
-        if (memory.isLeaf()) {
-            if (currentBlock.size < blockSize) {
-                result.found = false;
-                return result;
-            } else if (currentBlock.size == blockSize) {
-                currentBlock.free = false;
-
-                result.found = true;
-                result.block = currentBlock;
-                return result;
-            } else {
-                Block leftBlock, rightBlock;
-                std::tie(leftBlock, rightBlock) = currentBlock.divide();
-                memory.setLeft(BlockBinaryTree(leftBlock));
-                memory.setRight(BlockBinaryTree(rightBlock));
-                AllocationResult subResult = _reserve(blockSize, memory.getLeft());
-                result.found = subResult.found;
-                result.block = subResult.block;
-                return result;
-            }
-        } else {
-            if (currentBlock.size <= blockSize) {
-                result.found = false;
-                return result;
-            } else {
-                BlockBinaryTree* searchSubTree = &memory.getLeft();
-                BlockBinaryTree* otherSubTree = &memory.getRight();
-                AllocationResult subResult = _reserve(blockSize, *searchSubTree);
-
-                if (!subResult.found) {
-                    searchSubTree = &memory.getRight();
-                    otherSubTree = &memory.getLeft();
-                    subResult = _reserve(blockSize, *searchSubTree);
-                }
-
-                if (!subResult.found) {
-                    result.found = false;
-                    return result;
-                } else {
-                    currentBlock.free = memory.getLeft().getValue().free || memory.getRight().getValue().free;
-
-                    result.found = true;
-                    result.block = subResult.block;
-                    return result;
-                }
-            }
-        }
-        throw std::runtime_error("This should not happen");
-    }
+size_t Chunk::getSize() const {
+    return mSize;
 }
 
-bool Chunk::free(Block block) {
-    bool result = _free(block, mTree);
-    return result;
+size_t Chunk::getUsedSize() const {
+    return mUsedSize;
 }
 
-const VkDeviceMemory Chunk::getMemory() const {
-    return mMemory;
+size_t Chunk::getRequestedSize() const {
+    return mRequestedSize;
 }
 
-BlockBinaryTree& Chunk::getTree() {
-    return mTree;
+size_t Chunk::getInternalFragmentation() const {
+    return mUsedSize - mRequestedSize;
 }
 
-void Chunk::setMinBlockSize(const size_t minBlockSize) {
-    mMinBlockSize = minBlockSize;
+void Chunk::setMappedPointer(void* mappedPointer) {
+    mMappedPointer = mappedPointer;
 }
 
-bool Chunk::_free(Block block, BlockBinaryTree& memory) {
-    Block& currentBlock = memory.getValue();
-    bool result;
-    if (currentBlock == block) {
-        currentBlock.free = true;
-
-        result = true;
-        return result;
-    } else if (currentBlock.size < block.size) {
-        result = false;
-        return result;
-    } else {
-        if (memory.isLeaf()) {
-            result = false;
-            return result;
-        } else {
-            bool resultLeft, resultRight;
-            resultLeft = _free(block, memory.getLeft());
-            resultRight = _free(block, memory.getRight());
+void* Chunk::getMappedPointer() const {
+    return mMappedPointer;
+}
 
-            currentBlock.free = memory.getLeft().getValue().free || memory.getRight().getValue().free;
+void Chunk::setTiling(ResourceTiling tiling) {
+    mTiling = tiling;
+}
 
-            if (memory.getLeft().isLeaf() && memory.getLeft().getValue().free &&
-                memory.getRight().isLeaf() && memory.getRight().getValue().free) {
-                memory.removeLeft();
-                memory.removeRight();
-            }
+ResourceTiling Chunk::getTiling() const {
+    return mTiling;
+}
 
-            result = resultLeft || resultRight;
+void Chunk::setPrewarmed(bool prewarmed) {
+    mPrewarmed = prewarmed;
+}
 
-            return result;
-        }
-    }
-}
\ No newline at end of file
+bool Chunk::isPrewarmed() const {
+    return mPrewarmed;
+}
@@ -0,0 +1,43 @@
+#include "memory/DedicatedChunk.hpp"
+
+DedicatedChunk::DedicatedChunk(VkDeviceMemory memory, const size_t chunkSize) : Chunk(memory, chunkSize) {
+}
+
+AllocationResult DedicatedChunk::reserve(const size_t blockSize, const size_t) {
+    /* The block starts at offset 0, which satisfies any alignment */
+    AllocationResult result;
+    result.found = false;
+
+    if (mUsedSize != 0 || blockSize > mSize) {
+        return result;
+    }
+
+    result.found = true;
+    result.block = Block(mSize, 0);
+    result.block.requestedSize = blockSize;
+    result.block.free = false;
+
+    mUsedSize = mSize;
+    mRequestedSize = blockSize;
+    return result;
+}
+
+bool DedicatedChunk::free(Block block) {
+    if (mUsedSize == 0 || block.offset != 0 || block.size != mSize) {
+        return false;
+    }
+
+    mUsedSize = 0;
+    mRequestedSize = 0;
+    return true;
+}
+
+AllocationStrategy DedicatedChunk::getStrategy() const {
+    return AllocationStrategy::Dedicated;
+}
+
+void DedicatedChunk::getFreeBlocks(std::vector<Block>& freeBlocks) const {
+    if (mUsedSize == 0) {
+        freeBlocks.push_back(Block(mSize, 0));
+    }
+}
@@ -0,0 +1,426 @@
+#include "memory/Defragmenter.hpp"
+
+#include <array>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+#include "memory/MemoryManager.hpp"
+#include "vulkan/VulkanContext.hpp"
+#include "utils.hpp"
+
+double Defragmenter::DefaultTimeBudget = 1.0;
+VkDeviceSize Defragmenter::DefaultMaximumBytesPerUpdate = 16 * mega;
+float Defragmenter::SparseChunkThreshold = 0.5f;
+
+void Defragmenter::create(VulkanContext& context) {
+    mContext = &context;
+    mMemoryManager = &context.getMemoryManager();
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(mContext->getDevice(), &fenceInfo, nullptr, &mTransferFence) != VK_SUCCESS) {
+        throw std::runtime_error("Error, failed to create fence");
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (vkCreateSemaphore(mContext->getDevice(), &semaphoreInfo, nullptr, &mTransferSemaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Error, failed to create semaphore");
+    }
+}
+
+void Defragmenter::destroy() {
+    if (mCommandBuffer != VK_NULL_HANDLE) {
+        vkWaitForFences(mContext->getDevice(), 1, &mTransferFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        vkFreeCommandBuffers(mContext->getDevice(), mContext->getTransferCommandPool().getHandler(), 1, &mCommandBuffer);
+        mCommandBuffer = VK_NULL_HANDLE;
+    }
+
+    vkDestroySemaphore(mContext->getDevice(), mTransferSemaphore, nullptr);
+    vkDestroyFence(mContext->getDevice(), mTransferFence, nullptr);
+}
+
+VkSemaphore Defragmenter::update() {
+    /* One evacuation at a time, the next chunk is picked once the previous copies have completed */
+    if (mCommandBuffer != VK_NULL_HANDLE) {
+        if (vkGetFenceStatus(mContext->getDevice(), mTransferFence) != VK_SUCCESS) {
+            return VK_NULL_HANDLE;
+        }
+
+        vkResetFences(mContext->getDevice(), 1, &mTransferFence);
+        CommandPool& transferCommandPool = mContext->getTransferCommandPool();
+        transferCommandPool.lock();
+        vkFreeCommandBuffers(mContext->getDevice(), transferCommandPool.getHandler(), 1, &mCommandBuffer);
+        transferCommandPool.unlock();
+        mCommandBuffer = VK_NULL_HANDLE;
+    }
+
+    uint32_t memoryTypeIndex, chunkIndex;
+    if (!selectChunk(memoryTypeIndex, chunkIndex) || evacuate(memoryTypeIndex, chunkIndex) == 0) {
+        return VK_NULL_HANDLE;
+    }
+    return mTransferSemaphore;
+}
+
+void Defragmenter::setTimeBudget(double milliseconds) {
+    mTimeBudget = milliseconds;
+}
+
+void Defragmenter::setMaximumBytesPerUpdate(VkDeviceSize bytes) {
+    mMaximumBytesPerUpdate = bytes;
+}
+
+bool Defragmenter::selectChunk(uint32_t& memoryTypeIndex, uint32_t& chunkIndex) {
+    /* Bytes of the movable resources of each chunk, a chunk is only evacuated when they are all it holds */
+    std::array<std::vector<VkDeviceSize>, VK_MAX_MEMORY_TYPES> movableBytes;
+    {
+        std::lock_guard<std::mutex> lock(mMemoryManager->mInfoMutex);
+        mMemoryManager->mAllocations.forEach([&movableBytes](AllocationHandle, const AllocationRecord& record) {
+            if (!record.movable || record.info.slab || record.info.cached) {
+                return;
+            }
+            std::vector<VkDeviceSize>& bytes = movableBytes[record.info.memoryTypeIndex];
+            if (bytes.size() <= record.info.chunkIndex) {
+                bytes.resize(record.info.chunkIndex + 1, 0);
+            }
+            bytes[record.info.chunkIndex] += record.info.block.size;
+        });
+    }
+
+    float lowestOccupancy = SparseChunkThreshold;
+    bool found{false};
+
+    for (auto& pair : mMemoryManager->mChunksMap) {
+        std::lock_guard<std::mutex> lock(mMemoryManager->mMemoryTypeMutexes[pair.first]);
+        std::vector<std::unique_ptr<Chunk>>& chunks = pair.second;
+        const std::vector<VkDeviceSize>& bytes = movableBytes[pair.first];
+
+        uint32_t pooledChunkCount{0};
+        for (auto& chunk : chunks) {
+            if (chunk && chunk->getStrategy() != AllocationStrategy::Dedicated) {
+                pooledChunkCount++;
+            }
+        }
+        if (pooledChunkCount < 2) {
+            continue;
+        }
+
+        /* A prewarmed chunk is kept even once empty, moving its content wouldn't release anything */
+        for (uint32_t i{0};i < chunks.size() && i < bytes.size();++i) {
+            if (!chunks[i] || chunks[i]->getStrategy() == AllocationStrategy::Dedicated || chunks[i]->isPrewarmed() ||
+                chunks[i]->getUsedSize() == 0 || bytes[i] != chunks[i]->getUsedSize()) {
+                continue;
+            }
+
+            float occupancy = static_cast<float>(chunks[i]->getUsedSize()) / chunks[i]->getSize();
+            if (occupancy < lowestOccupancy) {
+                lowestOccupancy = occupancy;
+                memoryTypeIndex = pair.first;
+                chunkIndex = i;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+VkDeviceSize Defragmenter::evacuate(uint32_t memoryTypeIndex, uint32_t chunkIndex) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<AllocationHandle> handles;
+    {
+        std::lock_guard<std::mutex> lock(mMemoryManager->mInfoMutex);
+        mMemoryManager->mAllocations.forEach([&](AllocationHandle handle, const AllocationRecord& record) {
+            if (record.movable && record.info.memoryTypeIndex == memoryTypeIndex && record.info.chunkIndex == chunkIndex) {
+                handles.push_back(handle);
+            }
+        });
+    }
+
+    std::vector<Move> moves;
+    VkDeviceSize movedBytes{0};
+    for (AllocationHandle handle : handles) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() > mTimeBudget || movedBytes >= mMaximumBytesPerUpdate) {
+            break;
+        }
+
+        Move move;
+        if (!reserve(handle, memoryTypeIndex, chunkIndex, move)) {
+            break;
+        }
+        moves.push_back(move);
+        movedBytes += move.info.block.size;
+    }
+
+    if (moves.empty()) {
+        return 0;
+    }
+
+    recordCopies(moves);
+    submit();
+
+    for (const Move& move : moves) {
+        complete(move);
+    }
+    return movedBytes;
+}
+
+bool Defragmenter::reserve(AllocationHandle handle, uint32_t memoryTypeIndex, uint32_t chunkIndex, Move& move) {
+    {
+        std::lock_guard<std::mutex> lock(mMemoryManager->mInfoMutex);
+        if (!mMemoryManager->mAllocations.contains(handle)) {
+            return false;
+        }
+        AllocationRecord& record = mMemoryManager->mAllocations.get(handle);
+        move.movable = record.movable;
+        move.sourceBuffer = record.buffer;
+        move.sourceImage = record.image;
+    }
+    if (!move.movable) {
+        return false;
+    }
+    move.allocation = handle;
+
+    VkDevice device = mContext->getDevice();
+    VkMemoryRequirements memoryRequirements;
+    ResourceTiling tiling{ResourceTiling::Linear};
+    if (move.sourceBuffer != VK_NULL_HANDLE) {
+        VkBufferCreateInfo createInfo = move.movable->bufferCreateInfo;
+        createInfo.pQueueFamilyIndices = move.movable->queueFamilyIndices.data();
+        if (vkCreateBuffer(device, &createInfo, nullptr, &move.buffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create buffer");
+        }
+        vkGetBufferMemoryRequirements(device, move.buffer, &memoryRequirements);
+    } else {
+        VkImageCreateInfo createInfo = move.movable->imageCreateInfo;
+        createInfo.pQueueFamilyIndices = move.movable->queueFamilyIndices.data();
+        if (vkCreateImage(device, &createInfo, nullptr, &move.image) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create image");
+        }
+        vkGetImageMemoryRequirements(device, move.image, &memoryRequirements);
+        if (createInfo.tiling == VK_IMAGE_TILING_OPTIMAL) {
+            tiling = ResourceTiling::Optimal;
+        }
+    }
+
+    /* Only compact into existing chunks, growing the pool would defeat the purpose */
+    bool reserved{false};
+    if (memoryRequirements.memoryTypeBits & (1 << memoryTypeIndex)) {
+        std::lock_guard<std::mutex> lock(mMemoryManager->mMemoryTypeMutexes[memoryTypeIndex]);
+        reserved = mMemoryManager->reserveInExistingChunks(memoryTypeIndex, memoryRequirements, tiling,
+                                                           move.info, chunkIndex);
+        mMemoryManager->updateUsage(memoryTypeIndex);
+    }
+    if (!reserved) {
+        if (move.buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, move.buffer, nullptr);
+        } else {
+            vkDestroyImage(device, move.image, nullptr);
+        }
+        return false;
+    }
+
+    VkDeviceMemory memory = mMemoryManager->getChunk(move.info).getMemory();
+    if (move.buffer != VK_NULL_HANDLE) {
+        vkBindBufferMemory(device, move.buffer, memory, move.info.block.offset);
+    } else {
+        vkBindImageMemory(device, move.image, memory, move.info.block.offset);
+    }
+    return true;
+}
+
+void Defragmenter::recordCopies(const std::vector<Move>& moves) {
+    /* The layout of a moved image changes for the copy, while frames in flight may still sample it */
+    bool movesImages = std::any_of(moves.begin(), moves.end(), [](const Move& move) { return move.image != VK_NULL_HANDLE; });
+    if (movesImages) {
+        vkQueueWaitIdle(mContext->getGraphicsQueue());
+    }
+
+    CommandPool& transferCommandPool = mContext->getTransferCommandPool();
+
+    VkCommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+    allocateInfo.commandPool = transferCommandPool.getHandler();
+
+    transferCommandPool.lock();
+    VkResult result = vkAllocateCommandBuffers(mContext->getDevice(), &allocateInfo, &mCommandBuffer);
+    transferCommandPool.unlock();
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate command buffer");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(mCommandBuffer, &beginInfo);
+
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+    /* The copies submitted earlier on this queue, the uploads among them, complete before the content is read */
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    for (const Move& move : moves) {
+        if (move.image == VK_NULL_HANDLE) {
+            continue;
+        }
+        imageBarrier.image = move.sourceImage;
+        imageBarrier.oldLayout = move.movable->layout;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        imageBarriers.push_back(imageBarrier);
+
+        imageBarrier.image = move.image;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageBarrier.srcAccessMask = 0;
+        imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageBarriers.push_back(imageBarrier);
+    }
+
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(mCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &memoryBarrier, 0, nullptr,
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+    for (const Move& move : moves) {
+        if (move.buffer != VK_NULL_HANDLE) {
+            VkBufferCopy region{};
+            region.size = move.movable->bufferCreateInfo.size;
+            vkCmdCopyBuffer(mCommandBuffer, move.sourceBuffer, move.buffer, 1, &region);
+            continue;
+        }
+
+        const VkImageCreateInfo& createInfo = move.movable->imageCreateInfo;
+        std::vector<VkImageCopy> regions(createInfo.mipLevels);
+        for (uint32_t i{0};i < createInfo.mipLevels;++i) {
+            regions[i].srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            regions[i].srcSubresource.mipLevel = i;
+            regions[i].srcSubresource.layerCount = createInfo.arrayLayers;
+            regions[i].dstSubresource = regions[i].srcSubresource;
+            regions[i].extent.width = std::max(createInfo.extent.width >> i, 1u);
+            regions[i].extent.height = std::max(createInfo.extent.height >> i, 1u);
+            regions[i].extent.depth = std::max(createInfo.extent.depth >> i, 1u);
+        }
+        vkCmdCopyImage(mCommandBuffer, move.sourceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       move.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       static_cast<uint32_t>(regions.size()), regions.data());
+    }
+
+    /* The owners switch right away, the copies they submit next on this queue must land after these ones */
+    imageBarriers.clear();
+    for (const Move& move : moves) {
+        if (move.image == VK_NULL_HANDLE) {
+            continue;
+        }
+        imageBarrier.image = move.image;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageBarrier.newLayout = move.movable->layout;
+        imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageBarriers.push_back(imageBarrier);
+    }
+
+    memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(mCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &memoryBarrier, 0, nullptr,
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+    vkEndCommandBuffer(mCommandBuffer);
+}
+
+void Defragmenter::submit() {
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &mCommandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &mTransferSemaphore;
+
+    if (vkQueueSubmit(mContext->getTransferQueue(), 1, &submitInfo, mTransferFence) != VK_SUCCESS) {
+        throw std::runtime_error("Error, failed to submit transfer command");
+    }
+}
+
+void Defragmenter::complete(const Move& move) {
+    /* Computed first, the memory type lock is taken before the resource info one */
+    Chunk& chunk = mMemoryManager->getChunk(move.info);
+    void* mappedPointer{nullptr};
+    if (chunk.getMappedPointer() != nullptr) {
+        mappedPointer = static_cast<uint8_t*>(chunk.getMappedPointer()) + move.info.block.offset;
+    }
+
+    /* The handle stays the same, only what it points to changes */
+    BufferInfo previousInfo;
+    bool freedByOwner;
+    {
+        std::lock_guard<std::mutex> lock(mMemoryManager->mInfoMutex);
+        freedByOwner = !mMemoryManager->mAllocations.contains(move.allocation) ||
+                       mMemoryManager->mAllocations.get(move.allocation).movable != move.movable;
+        if (!freedByOwner) {
+            AllocationRecord& record = mMemoryManager->mAllocations.get(move.allocation);
+            previousInfo = record.info;
+            record.info = move.info;
+            record.buffer = move.buffer;
+            record.image = move.image;
+            record.memory = chunk.getMemory();
+            record.mappedPointer = mappedPointer;
+        }
+    }
+
+    if (freedByOwner) {
+        cancel(move);
+        return;
+    }
+
+    if (move.buffer != VK_NULL_HANDLE) {
+        move.movable->onBufferMove(move.sourceBuffer, move.buffer);
+    } else {
+        move.movable->onImageMove(move.sourceImage, move.image);
+    }
+
+    /* The copy and the frames in flight read the previous resource until the current frame has completed */
+    MemoryManager* memoryManager = mMemoryManager;
+    VkDevice device = mContext->getDevice();
+    VkBuffer buffer = move.sourceBuffer;
+    VkImage image = move.sourceImage;
+    mMemoryManager->releaseDeferred([memoryManager, device, previousInfo, buffer, image]() {
+        memoryManager->release(previousInfo);
+        if (buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, buffer, nullptr);
+        } else {
+            vkDestroyImage(device, image, nullptr);
+        }
+    });
+}
+
+void Defragmenter::cancel(const Move& move) {
+    /* Freed by its owner meanwhile, the copy still writes the new resource until the current frame has completed */
+    MemoryManager* memoryManager = mMemoryManager;
+    VkDevice device = mContext->getDevice();
+    BufferInfo info = move.info;
+    VkBuffer buffer = move.buffer;
+    VkImage image = move.image;
+    mMemoryManager->releaseDeferred([memoryManager, device, info, buffer, image]() {
+        memoryManager->release(info);
+        if (buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, buffer, nullptr);
+        } else {
+            vkDestroyImage(device, image, nullptr);
+        }
+    });
+}
@@ -0,0 +1,88 @@
+#include "memory/FrameAllocator.hpp"
+
+#include <stdexcept>
+
+#include "memory/MemoryManager.hpp"
+#include "utils.hpp"
+
+VkDeviceSize FrameAllocator::DefaultRegionSize = 1 * mega;
+
+FrameAllocator::FrameAllocator(VkDevice& device, MemoryManager& memoryManager) :
+    mDevice(device), mMemoryManager(memoryManager) {
+}
+
+void FrameAllocator::create(uint32_t frameCount, VkDeviceSize regionSize, VkDeviceSize alignment) {
+    if (mBuffer != VK_NULL_HANDLE) {
+        throw std::runtime_error("Frame allocator already created");
+    }
+
+    mFrameCount = frameCount;
+    mAlignment = alignment;
+    /* Keep every region start aligned */
+    mRegionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = mRegionSize * frameCount;
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(mDevice, &bufferInfo, nullptr, &mBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create frame allocator buffer");
+    }
+
+    VkMemoryRequirements memoryRequirements{};
+    vkGetBufferMemoryRequirements(mDevice, mBuffer, &memoryRequirements);
+    mAllocation = mMemoryManager.allocateForBuffer(mBuffer, memoryRequirements, MemoryUsage::FrameConstants, "FrameAllocator");
+    mData = static_cast<uint8_t*>(mMemoryManager.getMappedPointer(mAllocation));
+
+    beginFrame(0);
+}
+
+void FrameAllocator::destroy() {
+    if (mBuffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    /* Also destroys the buffer */
+    mMemoryManager.freeAllocation(mAllocation);
+    mAllocation = AllocationHandle();
+    mBuffer = VK_NULL_HANDLE;
+    mData = nullptr;
+}
+
+void FrameAllocator::beginFrame(uint32_t frameIndex) {
+    if (frameIndex >= mFrameCount) {
+        throw std::runtime_error("Frame index out of the frame allocator range");
+    }
+
+    mOffset = frameIndex * mRegionSize;
+    mRegionEnd = mOffset + mRegionSize;
+}
+
+FrameAllocation FrameAllocator::allocate(VkDeviceSize size) {
+    VkDeviceSize offset = (mOffset + mAlignment - 1) / mAlignment * mAlignment;
+    if (offset + size > mRegionEnd) {
+        throw std::runtime_error("Frame allocator region exhausted");
+    }
+    mOffset = offset + size;
+
+    FrameAllocation allocation;
+    allocation.buffer = mBuffer;
+    allocation.offset = offset;
+    allocation.data = mData + offset;
+    return allocation;
+}
+
+VkBuffer FrameAllocator::getBuffer() const {
+    return mBuffer;
+}
+
+VkDeviceSize FrameAllocator::getAlignment() const {
+    return mAlignment;
+}
+
+bool FrameAllocator::isCreated() const {
+    return mBuffer != VK_NULL_HANDLE;
+}
@@ -1,61 +1,125 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <numeric>
 
 #include "memory/MemoryManager.hpp"
+#include "memory/BuddyChunk.hpp"
+#include "memory/TlsfChunk.hpp"
+#include "memory/DedicatedChunk.hpp"
 
 #include "PrintHelper.hpp"
 #include "utils.hpp"
 
-uint32_t MemoryManager::allocationSize = 32 * mega;
+uint32_t MemoryManager::minimumAllocationSize = 4 * mega;
+uint32_t MemoryManager::maximumAllocationSize = 256 * mega;
 uint32_t MemoryManager::pageSize = 4 * kilo;
+float MemoryManager::defaultBudgetRatio = 0.8f;
 
 MemoryManager::MemoryManager(VkPhysicalDevice& physicalDevice, VkDevice& device) :
-    mDevice(device), mPhysicalDevice(physicalDevice) {
+    mDevice(device), mPhysicalDevice(physicalDevice), mFrameAllocator(device, *this),
+    mGeometryPool(device, *this), mStagingPool(device, *this) {
 }
 
 void MemoryManager::init() {
     VkPhysicalDeviceProperties properties;
     vkGetPhysicalDeviceProperties(mPhysicalDevice, &properties);
 
-    if (pageSize < properties.limits.bufferImageGranularity) {
-        pageSize = properties.limits.bufferImageGranularity;
-    }
+    /* Blocks start on a multiple of the smallest block granularity, below it neighbours never share a page */
+    mSeparateTilings = properties.limits.bufferImageGranularity > std::min(TlsfChunk::Granularity, static_cast<size_t>(pageSize));
 
     vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &mMemoryProperties);
+
+    /* The pool buffers are only created on their first allocation */
+    mGeometryPool.create(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                         MemoryUsage::GpuOnly, sizeof(uint32_t), mSharedQueueFamilies);
+    mStagingPool.create(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryUsage::CpuToGpu,
+                        properties.limits.optimalBufferCopyOffsetAlignment, mSharedQueueFamilies);
+
+    /* Create every chunk list up front, the map must not change once other threads allocate */
+    for (uint32_t i{0};i < mMemoryProperties.memoryTypeCount;++i) {
+        mChunksMap[i];
+    }
+
+    if (mDedicatedAllocationSupported) {
+        mGetBufferMemoryRequirements2 = reinterpret_cast<PFN_vkGetBufferMemoryRequirements2KHR>(
+            vkGetDeviceProcAddr(mDevice, "vkGetBufferMemoryRequirements2KHR"));
+        mGetImageMemoryRequirements2 = reinterpret_cast<PFN_vkGetImageMemoryRequirements2KHR>(
+            vkGetDeviceProcAddr(mDevice, "vkGetImageMemoryRequirements2KHR"));
+        if (mGetBufferMemoryRequirements2 == nullptr || mGetImageMemoryRequirements2 == nullptr) {
+            mDedicatedAllocationSupported = false;
+        }
+    }
+
+    /* Device local only memory mostly holds odd-sized geometry and images, use TLSF to avoid the power of two rounding */
+    for (uint32_t i{0};i < mMemoryProperties.memoryTypeCount;++i) {
+        VkMemoryPropertyFlags flags = mMemoryProperties.memoryTypes[i].propertyFlags;
+        if (mStrategies.find(i) == mStrategies.end()) {
+            bool deviceOnly = (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            mStrategies[i] = deviceOnly ? AllocationStrategy::Tlsf : AllocationStrategy::Buddy;
+        }
+    }
+
+    /* Allocate up front what the previous run ended up needing */
+    AllocationProfile profile;
+    if (!mProfileFilename.empty() && profile.load(mProfileFilename)) {
+        prewarm(profile);
+    }
 }
 
 void MemoryManager::printInfo() {
+    size_t allocatedMemoryTypeCount = std::count_if(mChunksMap.begin(), mChunksMap.end(),
+        [](const std::pair<const uint32_t, std::vector<std::unique_ptr<Chunk>>>& pair) { return !pair.second.empty(); });
     std::cout << "[Allocated MemoryTypeCount]" << std::endl;
-    std::cout << mChunksMap.size() << std::endl << std::endl;
+    std::cout << allocatedMemoryTypeCount << std::endl << std::endl;
     
     std::cout << "[Chunks Allocation Summary]" << std::endl;
     for (auto& pair : mChunksMap) {
-        std::cout << "Memory Type: " << pair.first << std::endl;
+        std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[pair.first]);
+        if (pair.second.empty()) {
+            continue;
+        }
+        std::cout << "Memory Type: " << pair.first
+                  << (getAllocationStrategy(pair.first) == AllocationStrategy::Tlsf ? " (TLSF)" : " (Buddy)") << std::endl;
         for (uint32_t i{0};i < pair.second.size();++i) {
-            Chunk& chunk = pair.second[i];
-            std::cout << "\tChunk #" << i << " allocated " << chunk.getTree().getValue().size << " bytes" << std::endl;
+            if (!pair.second[i]) {
+                continue;
+            }
+            Chunk& chunk = *pair.second[i];
+            std::cout << "\tChunk #" << i << (chunk.getStrategy() == AllocationStrategy::Dedicated ? " (dedicated)" : "")
+                      << " allocated " << chunk.getSize() << " bytes, "
+                      << chunk.getUsedSize() << " used, "
+                      << chunk.getInternalFragmentation() << " lost to internal fragmentation" << std::endl;
         }
         std::cout << std::endl;
     }
 
+    std::lock_guard<std::mutex> lock(mInfoMutex);
     std::cout << "[Buffer Block Summary]" << std::endl;
-    for (auto& pair : mBuffersInfo) {
-        std::cout << "Buffer " << pair.first
-                << "\tMemoryTypeIndex: " << pair.second.memoryTypeIndex << "\n"
-                << "\tChunkIndex: " << pair.second.chunkIndex << "\n"
-                << "\tBlock size: " << pair.second.block.size << "\n"
-                << "\tBlock offset: " << pair.second.block.offset << "\n" << std::endl;
-    }
+    mAllocations.forEach([](AllocationHandle, const AllocationRecord& record) {
+        if (record.buffer == VK_NULL_HANDLE) {
+            return;
+        }
+        std::cout << "Buffer " << record.buffer
+                << "\tMemoryTypeIndex: " << record.info.memoryTypeIndex << "\n"
+                << "\tChunkIndex: " << record.info.chunkIndex << "\n"
+                << "\tBlock size: " << record.info.block.size << "\n"
+                << "\tBlock offset: " << record.info.block.offset << "\n" << std::endl;
+    });
 
     std::cout << "[Image Block Summary]" << std::endl;
-    for (auto& pair : mImagesInfo) {
-        std::cout << "Image " << pair.first
-                << "\tMemoryTypeIndex: " << pair.second.memoryTypeIndex << "\n"
-                << "\tChunkIndex: " << pair.second.chunkIndex << "\n"
-                << "\tBlock size: " << pair.second.block.size << "\n"
-                << "\tBlock offset: " << pair.second.block.offset << "\n" << std::endl;
-    }
+    mAllocations.forEach([](AllocationHandle, const AllocationRecord& record) {
+        if (record.image == VK_NULL_HANDLE) {
+            return;
+        }
+        std::cout << "Image " << record.image
+                << "\tMemoryTypeIndex: " << record.info.memoryTypeIndex << "\n"
+                << "\tChunkIndex: " << record.info.chunkIndex << "\n"
+                << "\tBlock size: " << record.info.block.size << "\n"
+                << "\tBlock offset: " << record.info.block.offset << "\n" << std::endl;
+    });
 }
 
 void MemoryManager::memoryCheckLog() {
@@ -63,183 +127,1192 @@ void MemoryManager::memoryCheckLog() {
     file.open("./memory.log", std::ios::out | std::ios::trunc);
 
     for (auto& pair : mChunksMap) {
-        file << "Memory Type #" << pair.first << " : " << pair.second.size() << " allocation(s)" << std::endl;
+        size_t allocationCount;
+        {
+            std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[pair.first]);
+            if (pair.second.empty()) {
+                continue;
+            }
+            allocationCount = std::count_if(pair.second.begin(), pair.second.end(),
+                                            [](const std::unique_ptr<Chunk>& chunk) { return chunk != nullptr; });
+        }
+        file << "Memory Type #" << pair.first << " : " << allocationCount << " allocation(s), "
+             << getInternalFragmentation(pair.first) << " byte(s) of internal fragmentation" << std::endl;
+    }
+
+    for (uint32_t i{0};i < mMemoryProperties.memoryHeapCount;++i) {
+        file << "Memory Heap #" << i << " : " << mHeapPeakUsedBytes[i] << " byte(s) used at peak out of "
+             << mMemoryProperties.memoryHeaps[i].size << std::endl;
+    }
+
+    file.close();
+}
+
+void MemoryManager::printAllocationReport() {
+    std::lock_guard<std::mutex> lock(mInfoMutex);
+    const std::vector<NamedUsage>& usages = mNames.getUsages();
+
+    /* The oldest live allocation of a name, the usual suspect when it leaks */
+    std::vector<const AllocationRecord*> oldestRecords(usages.size(), nullptr);
+    mAllocations.forEach([&oldestRecords](AllocationHandle, const AllocationRecord& record) {
+        const AllocationRecord*& oldest = oldestRecords[record.nameId];
+        if (oldest == nullptr || record.time < oldest->time) {
+            oldest = &record;
+        }
+    });
+
+    std::vector<uint32_t> nameIds(usages.size());
+    std::iota(nameIds.begin(), nameIds.end(), 0);
+    std::sort(nameIds.begin(), nameIds.end(), [&usages](uint32_t a, uint32_t b) {
+        if (usages[a].liveBytes != usages[b].liveBytes) {
+            return usages[a].liveBytes > usages[b].liveBytes;
+        }
+        return usages[a].peakBytes > usages[b].peakBytes;
+    });
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::cout << "[Allocations By Name]" << std::endl;
+    for (uint32_t nameId : nameIds) {
+        const NamedUsage& usage = usages[nameId];
+        std::cout << usage.name << ": " << usage.liveCount << " live allocation(s), " << usage.liveBytes << " byte(s), peak "
+                  << usage.peakBytes << " byte(s) over " << usage.totalCount << " allocation(s)" << std::endl;
+        if (oldestRecords[nameId] != nullptr) {
+            std::chrono::duration<double> age = now - oldestRecords[nameId]->time;
+            std::cout << "\tOldest: " << oldestRecords[nameId]->size << " byte(s) in memory type "
+                      << oldestRecords[nameId]->info.memoryTypeIndex << ", allocated at frame " << oldestRecords[nameId]->frame
+                      << " (" << std::fixed << std::setprecision(1) << age.count() << " s ago)" << std::endl;
+        }
+    }
+    std::cout << std::endl;
+}
+
+MemoryStatistics MemoryManager::queryStatistics() {
+    MemoryStatistics statistics;
+
+    statistics.types.resize(mMemoryProperties.memoryTypeCount);
+    for (uint32_t i{0};i < mMemoryProperties.memoryTypeCount;++i) {
+        statistics.types[i].heapIndex = mMemoryProperties.memoryTypes[i].heapIndex;
+        statistics.types[i].flags = mMemoryProperties.memoryTypes[i].propertyFlags;
+        statistics.types[i].usage = getChunksStatistics(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mInfoMutex);
+        mAllocations.forEach([&statistics](AllocationHandle, const AllocationRecord& record) {
+            statistics.types[record.info.memoryTypeIndex].usage.allocationCount++;
+        });
+    }
+
+    statistics.heaps.resize(mMemoryProperties.memoryHeapCount);
+    for (uint32_t i{0};i < mMemoryProperties.memoryHeapCount;++i) {
+        statistics.heaps[i].heapSize = mMemoryProperties.memoryHeaps[i].size;
+        statistics.heaps[i].flags = mMemoryProperties.memoryHeaps[i].flags;
+        statistics.heaps[i].usage.peakUsedBytes = mHeapPeakUsedBytes[i];
+    }
+
+    for (MemoryTypeStatistics& type : statistics.types) {
+        computeExternalFragmentation(type.usage);
+        accumulate(statistics.heaps[type.heapIndex].usage, type.usage);
+        accumulate(statistics.total, type.usage);
+    }
+    for (MemoryHeapStatistics& heap : statistics.heaps) {
+        computeExternalFragmentation(heap.usage);
+    }
+    statistics.total.peakUsedBytes = mTotalPeakUsedBytes;
+    computeExternalFragmentation(statistics.total);
+
+    return statistics;
+}
+
+void MemoryManager::exportOccupancy(const std::string& filename) {
+    /* Blocks held by thread caches belong to no resource, they show up as used space between the allocations */
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<Block>> allocations;
+    {
+        std::lock_guard<std::mutex> lock(mInfoMutex);
+        mAllocations.forEach([&allocations](AllocationHandle, const AllocationRecord& record) {
+            allocations[{record.info.memoryTypeIndex, record.info.chunkIndex}].push_back(record.info.block);
+        });
+    }
+
+    std::ofstream file;
+    file.open(filename, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + filename);
+    }
+
+    file << "{\n  \"pageSize\": " << pageSize << ",\n  \"memoryTypes\": [";
+
+    std::vector<Block> freeBlocks;
+    bool firstType{true};
+    for (auto& pair : mChunksMap) {
+        std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[pair.first]);
+        if (pair.second.empty()) {
+            continue;
+        }
+
+        file << (firstType ? "" : ",") << "\n    {\"index\": " << pair.first
+             << ", \"heapIndex\": " << mMemoryProperties.memoryTypes[pair.first].heapIndex
+             << ", \"strategy\": \"" << getStrategyName(getAllocationStrategy(pair.first)) << "\", \"chunks\": [";
+        firstType = false;
+
+        bool firstChunk{true};
+        for (uint32_t i{0};i < pair.second.size();++i) {
+            if (!pair.second[i]) {
+                continue;
+            }
+            Chunk& chunk = *pair.second[i];
+
+            file << (firstChunk ? "" : ",") << "\n      {\"index\": " << i
+                 << ", \"strategy\": \"" << getStrategyName(chunk.getStrategy())
+                 << "\", \"tiling\": \"" << (chunk.getTiling() == ResourceTiling::Optimal ? "optimal" : "linear")
+                 << "\", \"size\": " << chunk.getSize()
+                 << ", \"used\": " << chunk.getUsedSize()
+                 << ", \"requested\": " << chunk.getRequestedSize() << ",\n       \"allocations\": [";
+            firstChunk = false;
+
+            std::vector<Block>& blocks = allocations[{pair.first, i}];
+            std::sort(blocks.begin(), blocks.end(), [](const Block& a, const Block& b) { return a.offset < b.offset; });
+            for (size_t j{0};j < blocks.size();++j) {
+                file << (j == 0 ? "" : ", ") << "[" << blocks[j].offset << ", " << blocks[j].size << ", " << blocks[j].requestedSize << "]";
+            }
+
+            freeBlocks.clear();
+            chunk.getFreeBlocks(freeBlocks);
+            std::sort(freeBlocks.begin(), freeBlocks.end(), [](const Block& a, const Block& b) { return a.offset < b.offset; });
+            file << "],\n       \"free\": [";
+            for (size_t j{0};j < freeBlocks.size();++j) {
+                file << (j == 0 ? "" : ", ") << "[" << freeBlocks[j].offset << ", " << freeBlocks[j].size << "]";
+            }
+            file << "]}";
+        }
+        file << "\n    ]}";
     }
 
+    file << "\n  ]\n}\n";
     file.close();
 }
 
-void MemoryManager::allocate(uint32_t memoryTypeIndex) {
+const char* MemoryManager::getStrategyName(AllocationStrategy strategy) {
+    switch (strategy) {
+        case AllocationStrategy::Buddy:
+            return "Buddy";
+        case AllocationStrategy::Tlsf:
+            return "TLSF";
+        case AllocationStrategy::Dedicated:
+            return "Dedicated";
+    }
+    return "Unknown";
+}
+
+uint32_t MemoryManager::allocate(uint32_t memoryTypeIndex, VkDeviceSize minimumSize, ResourceTiling tiling) {
+    /* Chunks grow geometrically with the number of chunks already living in this memory type */
+    uint32_t liveChunkCount{0};
+    for (auto& chunk : mChunksMap[memoryTypeIndex]) {
+        if (chunk && chunk->getStrategy() != AllocationStrategy::Dedicated) {
+            liveChunkCount++;
+        }
+    }
+
+    VkDeviceSize chunkSize = minimumAllocationSize;
+    for (uint32_t i{0};i < liveChunkCount && chunkSize < maximumAllocationSize;++i) {
+        chunkSize *= 2;
+    }
+    while (chunkSize < minimumSize) {
+        chunkSize *= 2;
+    }
+
     VkMemoryAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.memoryTypeIndex = memoryTypeIndex;
-    allocInfo.allocationSize = allocationSize;
 
+    /* If the heap can't provide a big chunk, fall back to smaller ones before giving up */
     VkDeviceMemory memoryAllocation;
-    VkResult result = vkAllocateMemory(mDevice, &allocInfo, nullptr, &memoryAllocation); 
+    VkResult result;
+    while (true) {
+        allocInfo.allocationSize = chunkSize;
+        result = vkAllocateMemory(mDevice, &allocInfo, nullptr, &memoryAllocation);
+        if (result == VK_SUCCESS || chunkSize / 2 < std::max(minimumSize, static_cast<VkDeviceSize>(minimumAllocationSize))) {
+            break;
+        }
+        chunkSize /= 2;
+    }
+
+    /* The heap is exhausted, let the caller try another memory type */
     if (result != VK_SUCCESS) {
-        // This is temporary, if the allocation is not successful, it could be harmless
-        std::cout << "Failed to allocate memory" << std::endl;
+        return NoChunk;
     }
 
-    if (mChunksMap.find(memoryTypeIndex) == mChunksMap.end()) {
-        mChunksMap[memoryTypeIndex] = std::vector<Chunk>();
+    std::unique_ptr<Chunk> chunk;
+    if (getAllocationStrategy(memoryTypeIndex) == AllocationStrategy::Tlsf) {
+        chunk = std::make_unique<TlsfChunk>(memoryAllocation, chunkSize);
+    } else {
+        chunk = std::make_unique<BuddyChunk>(memoryAllocation, chunkSize, pageSize);
     }
+    chunk->setTiling(tiling);
+    uint32_t chunkIndex = insertChunk(memoryTypeIndex, std::move(chunk));
+    recordChunkPeak(memoryTypeIndex);
+    return chunkIndex;
+}
 
-    mChunksMap[memoryTypeIndex].push_back(Chunk(memoryAllocation, allocationSize, pageSize));
+void MemoryManager::recordChunkPeak(uint32_t memoryTypeIndex) {
+    MemoryTypeProfile& profile = mRecordedProfile.types[memoryTypeIndex];
+    VkDeviceSize reservedBytes{0};
+    for (auto& chunk : mChunksMap[memoryTypeIndex]) {
+        if (chunk && chunk->getStrategy() != AllocationStrategy::Dedicated) {
+            reservedBytes += chunk->getSize();
+        }
+    }
+    if (reservedBytes <= profile.peakReservedBytes) {
+        return;
+    }
+
+    profile.flags = mMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    profile.peakReservedBytes = reservedBytes;
+    profile.chunks.clear();
+    for (auto& chunk : mChunksMap[memoryTypeIndex]) {
+        if (chunk && chunk->getStrategy() != AllocationStrategy::Dedicated) {
+            profile.chunks.push_back({static_cast<VkDeviceSize>(chunk->getSize()), chunk->getTiling()});
+        }
+    }
+}
+
+void MemoryManager::prewarm(const AllocationProfile& profile) {
+    for (uint32_t i{0};i < mMemoryProperties.memoryTypeCount;++i) {
+        const MemoryTypeProfile& typeProfile = profile.types[i];
+
+        /* The profile may have been recorded on another device */
+        if (typeProfile.chunks.empty() || typeProfile.flags != mMemoryProperties.memoryTypes[i].propertyFlags) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[i]);
+        for (const ProfiledChunk& chunk : typeProfile.chunks) {
+            uint32_t chunkIndex = allocate(i, chunk.size, chunk.tiling);
+            if (chunkIndex == NoChunk) {
+                break;
+            }
+            mChunksMap[i][chunkIndex]->setPrewarmed(true);
+        }
+
+        /* Pre-split the slabs as well, so that thread cache refills don't split blocks either */
+        for (uint32_t j{0};j < SlabAllocator::SizeClassCount;++j) {
+            for (uint32_t k{0};k < typeProfile.slabCounts[j];++k) {
+                if (!addSlab(i, j)) {
+                    break;
+                }
+            }
+        }
+        updateUsage(i);
+    }
+}
+
+uint32_t MemoryManager::allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer buffer, VkImage image) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+    allocInfo.allocationSize = size;
+
+    VkMemoryDedicatedAllocateInfoKHR dedicatedInfo{};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO_KHR;
+    dedicatedInfo.buffer = buffer;
+    dedicatedInfo.image = image;
+    if (mDedicatedAllocationSupported) {
+        allocInfo.pNext = &dedicatedInfo;
+    }
+
+    VkDeviceMemory memoryAllocation;
+    if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &memoryAllocation) != VK_SUCCESS) {
+        return NoChunk;
+    }
+
+    return insertChunk(memoryTypeIndex, std::make_unique<DedicatedChunk>(memoryAllocation, size));
+}
+
+uint32_t MemoryManager::insertChunk(uint32_t memoryTypeIndex, std::unique_ptr<Chunk> chunk) {
+    /* Host visible chunks stay mapped for their whole lifetime, so that buffers sharing a chunk can be written concurrently */
+    if (mMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void* mappedPointer;
+        if (vkMapMemory(mDevice, chunk->getMemory(), 0, VK_WHOLE_SIZE, 0, &mappedPointer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map memory");
+        }
+        chunk->setMappedPointer(mappedPointer);
+    }
+
+    /* Reuse the slot of a released chunk so that the indices of the others stay valid */
+    std::vector<std::unique_ptr<Chunk>>& chunks = mChunksMap[memoryTypeIndex];
+    for (uint32_t i{0};i < chunks.size();++i) {
+        if (!chunks[i]) {
+            chunks[i] = std::move(chunk);
+            return i;
+        }
+    }
+
+    chunks.push_back(std::move(chunk));
+    return chunks.size() - 1;
+}
+
+void MemoryManager::releaseChunkIfUnused(uint32_t memoryTypeIndex, uint32_t chunkIndex) {
+    std::vector<std::unique_ptr<Chunk>>& chunks = mChunksMap[memoryTypeIndex];
+    Chunk& chunk = *chunks[chunkIndex];
+    if (chunk.getUsedSize() != 0 || chunk.isPrewarmed()) {
+        return;
+    }
+
+    /* Keep the last pooled chunk of a memory type around to avoid allocating it again right away */
+    if (chunk.getStrategy() != AllocationStrategy::Dedicated) {
+        bool otherPooledChunk = std::any_of(chunks.begin(), chunks.end(),
+            [&chunk](const std::unique_ptr<Chunk>& other) {
+                return other && other.get() != &chunk && other->getStrategy() != AllocationStrategy::Dedicated;
+            });
+        if (!otherPooledChunk) {
+            return;
+        }
+    }
+
+    if (chunk.getMappedPointer() != nullptr) {
+        vkUnmapMemory(mDevice, chunk.getMemory());
+    }
+    vkFreeMemory(mDevice, chunk.getMemory(), nullptr);
+    chunks[chunkIndex].reset();
+}
+
+bool MemoryManager::needsDedicatedAllocation(VkMemoryRequirements& memoryRequirements, VkBuffer buffer, VkImage image) {
+    /* A resource this big would leave most of a chunk unusable for anything else */
+    if (memoryRequirements.size > maximumAllocationSize / 2) {
+        return true;
+    }
+
+    if (!mDedicatedAllocationSupported) {
+        return false;
+    }
+
+    VkMemoryDedicatedRequirementsKHR dedicatedRequirements{};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS_KHR;
+
+    VkMemoryRequirements2KHR memoryRequirements2{};
+    memoryRequirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2_KHR;
+    memoryRequirements2.pNext = &dedicatedRequirements;
+
+    if (buffer != VK_NULL_HANDLE) {
+        VkBufferMemoryRequirementsInfo2KHR info{};
+        info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2_KHR;
+        info.buffer = buffer;
+        mGetBufferMemoryRequirements2(mDevice, &info, &memoryRequirements2);
+    } else {
+        VkImageMemoryRequirementsInfo2KHR info{};
+        info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2_KHR;
+        info.image = image;
+        mGetImageMemoryRequirements2(mDevice, &info, &memoryRequirements2);
+    }
+
+    return dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
 }
 
 void MemoryManager::cleanup() {
+    if (!mProfileFilename.empty()) {
+        mRecordedProfile.save(mProfileFilename, mMemoryProperties.memoryTypeCount);
+    }
+
+    /* The device is idle, everything still queued can go, the pools included */
+    flushDeferredReleases();
+    mFrameAllocator.destroy();
+    mGeometryPool.destroy();
+    mStagingPool.destroy();
+    flushDeferredReleases();
+
+    /* Everything left is owned by nobody anymore */
+    size_t leakCount;
+    {
+        std::lock_guard<std::mutex> lock(mInfoMutex);
+        leakCount = mAllocations.size();
+    }
+    if (leakCount != 0) {
+        std::cout << "[Memory Leaks]" << std::endl;
+        std::cout << leakCount << " allocation(s) never freed" << std::endl << std::endl;
+        printAllocationReport();
+    }
+
+    /* Cached blocks and slabs live in the chunks freed below, they only have to be forgotten */
+    mThreadCaches.clear();
+    for (SlabAllocator& slabAllocator : mSlabAllocators) {
+        slabAllocator.clear();
+    }
+
     for (auto& pair : mChunksMap) {
         for (auto& chunk : pair.second) {
-            vkFreeMemory(mDevice, chunk.getMemory(), nullptr);
+            if (!chunk) {
+                continue;
+            }
+            if (chunk->getMappedPointer() != nullptr) {
+                vkUnmapMemory(mDevice, chunk->getMemory());
+            }
+            vkFreeMemory(mDevice, chunk->getMemory(), nullptr);
         }
     }
+
+    mTrace.close();
 }
 
-void MemoryManager::allocateForBuffer(VkBuffer buffer,
-                                      VkMemoryRequirements& memoryRequirements,
-                                      VkMemoryPropertyFlags properties,
-                                      std::string name) {
-    int32_t memoryTypeIndex = findMemoryType(memoryRequirements, properties);
+AllocationHandle MemoryManager::allocateForBuffer(VkBuffer buffer,
+                                                  VkMemoryRequirements& memoryRequirements,
+                                                  VkMemoryPropertyFlags properties,
+                                                  const std::string& name) {
+    MemoryTypeRequest request;
+    request.requiredFlags = properties;
+    BufferInfo bufferInfo = reserve(memoryRequirements, request, buffer, VK_NULL_HANDLE, ResourceTiling::Linear);
+    AllocationHandle handle = registerAllocation(bufferInfo, buffer, VK_NULL_HANDLE, name, memoryRequirements.size);
+    mTrace.recordAllocation(handle, memoryRequirements, mMemoryProperties.memoryTypes[bufferInfo.memoryTypeIndex].propertyFlags,
+                            false, ResourceTiling::Linear);
 
-    if (memoryTypeIndex == -1) {
-        throw std::runtime_error("Unable to find a suitable memory type");
+    vkBindBufferMemory(mDevice, buffer, getChunk(bufferInfo).getMemory(), bufferInfo.block.offset);
+    return handle;
+}
+
+AllocationHandle MemoryManager::allocateForImage(VkImage image,
+                                                 VkMemoryRequirements& memoryRequirements,
+                                                 VkMemoryPropertyFlags properties,
+                                                 const std::string& name,
+                                                 VkImageTiling tiling) {
+    MemoryTypeRequest request;
+    request.requiredFlags = properties;
+    BufferInfo imageInfo = reserve(memoryRequirements, request, VK_NULL_HANDLE, image,
+                                   tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceTiling::Optimal : ResourceTiling::Linear);
+    AllocationHandle handle = registerAllocation(imageInfo, VK_NULL_HANDLE, image, name, memoryRequirements.size);
+    mTrace.recordAllocation(handle, memoryRequirements, mMemoryProperties.memoryTypes[imageInfo.memoryTypeIndex].propertyFlags,
+                            true, tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceTiling::Optimal : ResourceTiling::Linear);
+
+    vkBindImageMemory(mDevice, image, getChunk(imageInfo).getMemory(), imageInfo.block.offset);
+    return handle;
+}
+
+AllocationHandle MemoryManager::allocateForBuffer(VkBuffer buffer,
+                                                  VkMemoryRequirements& memoryRequirements,
+                                                  MemoryUsage usage,
+                                                  const std::string& name) {
+    BufferInfo bufferInfo = reserve(memoryRequirements, getMemoryTypeRequest(usage), buffer, VK_NULL_HANDLE, ResourceTiling::Linear);
+    AllocationHandle handle = registerAllocation(bufferInfo, buffer, VK_NULL_HANDLE, name, memoryRequirements.size);
+    mTrace.recordAllocation(handle, memoryRequirements, mMemoryProperties.memoryTypes[bufferInfo.memoryTypeIndex].propertyFlags,
+                            false, ResourceTiling::Linear);
+
+    vkBindBufferMemory(mDevice, buffer, getChunk(bufferInfo).getMemory(), bufferInfo.block.offset);
+    return handle;
+}
+
+AllocationHandle MemoryManager::allocateForImage(VkImage image,
+                                                 VkMemoryRequirements& memoryRequirements,
+                                                 MemoryUsage usage,
+                                                 const std::string& name,
+                                                 VkImageTiling tiling) {
+    BufferInfo imageInfo = reserve(memoryRequirements, getMemoryTypeRequest(usage), VK_NULL_HANDLE, image,
+                                   tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceTiling::Optimal : ResourceTiling::Linear);
+    AllocationHandle handle = registerAllocation(imageInfo, VK_NULL_HANDLE, image, name, memoryRequirements.size);
+    mTrace.recordAllocation(handle, memoryRequirements, mMemoryProperties.memoryTypes[imageInfo.memoryTypeIndex].propertyFlags,
+                            true, tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceTiling::Optimal : ResourceTiling::Linear);
+
+    vkBindImageMemory(mDevice, image, getChunk(imageInfo).getMemory(), imageInfo.block.offset);
+    return handle;
+}
+
+void MemoryManager::freeAllocation(AllocationHandle handle) {
+    {
+        std::lock_guard<std::mutex> lock(mInfoMutex);
+        mTrace.recordFree(handle);
+
+        /* Unregistered right away so that the defragmenter doesn't move it while its release is pending */
+        mAllocations.get(handle).movable.reset();
+    }
+
+    /* Frames in flight may still use it, it is released once the current frame has completed */
+    queueRelease(handle, nullptr);
+}
+
+void MemoryManager::releaseDeferred(std::function<void()> release) {
+    queueRelease(AllocationHandle(), release);
+}
+
+void MemoryManager::beginFrame(uint32_t imageIndex) {
+    mTrace.recordFrame(imageIndex);
+
+    {
+        std::lock_guard<std::mutex> lock(mDeferredReleasesMutex);
+        if (imageIndex >= mImageFrames.size()) {
+            mImageFrames.resize(imageIndex + 1, 0);
+        }
+
+        /* The fence of this image has been waited for, and a queue completes its frames in order */
+        mCompletedFrame = std::max(mCompletedFrame, mImageFrames[imageIndex]);
+        mFrame++;
+        mImageFrames[imageIndex] = mFrame;
     }
 
-    if (mChunksMap.find(memoryTypeIndex) == mChunksMap.end()) {
-        allocate(memoryTypeIndex);
+    runDeferredReleases(false);
+
+    if (mFrameAllocator.isCreated()) {
+        mFrameAllocator.beginFrame(imageIndex);
     }
+}
 
-    for (uint32_t i{0};i < mChunksMap.size();++i) {
-        Chunk& chunk = mChunksMap[memoryTypeIndex][i];
-        AllocationResult result = chunk.reserve(memoryRequirements.size);
-        if (result.found) {
-            Block block = result.block;
-            //mBuffersInfo[buffer] = {}; // For testing purpose
-            mBuffersInfo[buffer].block = block;
-            mBuffersInfo[buffer].chunkIndex = i;
-            mBuffersInfo[buffer].memoryTypeIndex = memoryTypeIndex;
+void MemoryManager::flushDeferredReleases() {
+    runDeferredReleases(true);
+}
 
-            vkBindBufferMemory(mDevice, buffer, chunk.getMemory(), block.offset);
+void MemoryManager::queueRelease(AllocationHandle handle, std::function<void()> release) {
+    std::lock_guard<std::mutex> lock(mDeferredReleasesMutex);
+    mDeferredReleases.push_back({mFrame, handle, release});
+}
+
+void MemoryManager::runDeferredReleases(bool all) {
+    /* A release can queue other ones (an emptied pool block), so loop until nothing is left to do */
+    while (true) {
+        std::vector<DeferredRelease> releases;
+        {
+            std::lock_guard<std::mutex> lock(mDeferredReleasesMutex);
+            for (size_t i{0};i < mDeferredReleases.size();) {
+                if (all || mDeferredReleases[i].frame <= mCompletedFrame) {
+                    releases.push_back(std::move(mDeferredReleases[i]));
+                    mDeferredReleases[i] = std::move(mDeferredReleases.back());
+                    mDeferredReleases.pop_back();
+                } else {
+                    ++i;
+                }
+            }
+        }
+
+        if (releases.empty()) {
             return;
         }
+
+        for (DeferredRelease& release : releases) {
+            if (release.release) {
+                release.release();
+            } else {
+                releaseAllocation(release.allocation);
+            }
+        }
     }
+}
 
-    // If we come to this point, this means we need to allocate a new Chunk of memory because the previous one are full
-    allocate(memoryTypeIndex);
-    Chunk& chunk = mChunksMap[memoryTypeIndex].back();
-    AllocationResult result = chunk.reserve(memoryRequirements.size);
-    if (result.found) {
-        Block block = result.block;
-        //mBuffersInfo[buffer] = {}; // For testing purpose
-        mBuffersInfo[buffer].block = block;
-        mBuffersInfo[buffer].chunkIndex = mChunksMap[memoryTypeIndex].size() - 1;
-        mBuffersInfo[buffer].memoryTypeIndex = memoryTypeIndex;
-
-        vkBindBufferMemory(mDevice, buffer, chunk.getMemory(), block.offset);
-        return;
+void MemoryManager::releaseAllocation(AllocationHandle handle) {
+    AllocationRecord record;
+    {
+        std::lock_guard<std::mutex> lock(mInfoMutex);
+        record = mAllocations.get(handle);
+        mNames.remove(record.nameId, record.size);
+        mAllocations.erase(handle);
     }
 
-    throw std::runtime_error("Unable to find enough memory");
+    release(record.info);
+
+    if (record.buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(mDevice, record.buffer, nullptr);
+    } else {
+        vkDestroyImage(mDevice, record.image, nullptr);
+    }
 }
 
-void MemoryManager::allocateForImage(VkImage image,
-                                     VkMemoryRequirements& memoryRequirements,
-                                     VkMemoryPropertyFlags properties,
-                                     std::string name) {
-    int32_t memoryTypeIndex = findMemoryType(memoryRequirements, properties);
+void* MemoryManager::getMappedPointer(AllocationHandle handle) {
+    void* mappedPointer;
+    {
+        std::lock_guard<std::mutex> lock(mInfoMutex);
+        mappedPointer = mAllocations.get(handle).mappedPointer;
+    }
+    if (mappedPointer == nullptr) {
+        throw std::runtime_error("Trying to access a buffer that is not host visible");
+    }
+    return mappedPointer;
+}
+
+uint32_t MemoryManager::getHeapIndex(AllocationHandle handle) {
+    std::lock_guard<std::mutex> lock(mInfoMutex);
+    return mMemoryProperties.memoryTypes[mAllocations.get(handle).info.memoryTypeIndex].heapIndex;
+}
 
-    if (memoryTypeIndex == -1) {
+uint32_t MemoryManager::getPreferredHeapIndex(uint32_t memoryTypeBits, MemoryUsage usage) const {
+    std::vector<uint32_t> memoryTypes = findMemoryTypes(memoryTypeBits, getMemoryTypeRequest(usage));
+    if (memoryTypes.empty()) {
         throw std::runtime_error("Unable to find a suitable memory type");
     }
+    return mMemoryProperties.memoryTypes[memoryTypes.front()].heapIndex;
+}
 
-    if (mChunksMap.find(memoryTypeIndex) == mChunksMap.end()) {
-        allocate(memoryTypeIndex);
+VkDeviceSize MemoryManager::getAllocationSize(AllocationHandle handle) {
+    std::lock_guard<std::mutex> lock(mInfoMutex);
+    return mAllocations.get(handle).info.block.size;
+}
+
+MemoryHeapBudget MemoryManager::getHeapBudget(uint32_t heapIndex) {
+    MemoryHeapBudget heapBudget;
+
+    /* The driver knows best, other processes included */
+    if (mGetMemoryProperties2 != nullptr) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2KHR properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+        properties.pNext = &budgetProperties;
+        mGetMemoryProperties2(mPhysicalDevice, &properties);
+
+        heapBudget.budget = budgetProperties.heapBudget[heapIndex];
+        heapBudget.usage = budgetProperties.heapUsage[heapIndex];
+    } else {
+        heapBudget.budget = mHeapBudgets[heapIndex] != 0 ? mHeapBudgets[heapIndex] :
+            static_cast<VkDeviceSize>(mMemoryProperties.memoryHeaps[heapIndex].size * defaultBudgetRatio);
+        /* Count the blocks rather than the chunks, free room in a chunk can be reused without growing */
+        for (uint32_t i{0};i < mMemoryProperties.memoryTypeCount;++i) {
+            if (mMemoryProperties.memoryTypes[i].heapIndex == heapIndex) {
+                heapBudget.usage += mUsedBytes[i];
+            }
+        }
     }
 
-    for (uint32_t i{0};i < mChunksMap[memoryTypeIndex].size();++i) {
-        Chunk& chunk = mChunksMap[memoryTypeIndex][i];
-        AllocationResult result = chunk.reserve(memoryRequirements.size);
-        if (result.found) {
-            Block block = result.block;
-            //mBuffersInfo[buffer] = {}; // For testing purpose
-            mImagesInfo[image].block = block;
-            mImagesInfo[image].chunkIndex = i;
-            mImagesInfo[image].memoryTypeIndex = memoryTypeIndex;
+    /* A configured cap also applies on top of the driver budget */
+    if (mHeapBudgets[heapIndex] != 0) {
+        heapBudget.budget = std::min(heapBudget.budget, mHeapBudgets[heapIndex]);
+    }
+    return heapBudget;
+}
 
-            vkBindImageMemory(mDevice, image, chunk.getMemory(), block.offset);
-            return;
+void MemoryManager::setHeapBudget(uint32_t heapIndex, VkDeviceSize budget) {
+    mHeapBudgets[heapIndex] = budget;
+}
+
+void MemoryManager::createFrameAllocator(uint32_t frameCount, VkDeviceSize regionSize) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(mPhysicalDevice, &properties);
+
+    /* Every allocation must be usable as a dynamic uniform or storage buffer offset */
+    VkDeviceSize alignment = std::max(properties.limits.minUniformBufferOffsetAlignment,
+                                      properties.limits.minStorageBufferOffsetAlignment);
+
+    /* Created again when the image count changes, the previous buffer goes once its frames complete */
+    mFrameAllocator.destroy();
+    mFrameAllocator.create(frameCount, regionSize, alignment);
+}
+
+FrameAllocator& MemoryManager::getFrameAllocator() {
+    return mFrameAllocator;
+}
+
+BufferPool& MemoryManager::getBufferPool(BufferClass bufferClass) {
+    switch (bufferClass) {
+        case BufferClass::Geometry:
+            return mGeometryPool;
+        case BufferClass::Staging:
+        default:
+            return mStagingPool;
+    }
+}
+
+void MemoryManager::setAllocationStrategy(uint32_t memoryTypeIndex, AllocationStrategy strategy) {
+    if (strategy == AllocationStrategy::Dedicated) {
+        throw std::runtime_error("Dedicated allocations are chosen per resource, not per memory type");
+    }
+
+    std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[memoryTypeIndex]);
+    auto it = mChunksMap.find(memoryTypeIndex);
+    bool inUse = it != mChunksMap.end() && std::any_of(it->second.begin(), it->second.end(),
+        [](const std::unique_ptr<Chunk>& chunk) { return chunk != nullptr; });
+    if (inUse) {
+        throw std::runtime_error("Can't change the allocation strategy of a memory type already in use");
+    }
+    mStrategies[memoryTypeIndex] = strategy;
+}
+
+AllocationStrategy MemoryManager::getAllocationStrategy(uint32_t memoryTypeIndex) const {
+    auto it = mStrategies.find(memoryTypeIndex);
+    return it == mStrategies.end() ? AllocationStrategy::Buddy : it->second;
+}
+
+void MemoryManager::setDedicatedAllocationSupport(bool supported) {
+    mDedicatedAllocationSupported = supported;
+}
+
+void MemoryManager::setMemoryBudgetSupport(PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2) {
+    mGetMemoryProperties2 = getMemoryProperties2;
+}
+
+void MemoryManager::setAllocationProfile(std::string filename) {
+    mProfileFilename = filename;
+}
+
+void MemoryManager::setSharedQueueFamilies(std::vector<uint32_t> queueFamilyIndices) {
+    mSharedQueueFamilies = queueFamilyIndices;
+}
+
+void MemoryManager::setAllocationTrace(std::string filename) {
+    if (!mTrace.open(filename)) {
+        throw std::runtime_error("Failed to open " + filename);
+    }
+}
+
+void MemoryManager::setBufferMovable(AllocationHandle handle, const VkBufferCreateInfo& createInfo, BufferMoveCallback onMove) {
+    VkBufferUsageFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if ((createInfo.usage & transferUsage) != transferUsage) {
+        throw std::runtime_error("A movable buffer must be a transfer source and destination");
+    }
+
+    std::shared_ptr<MovableResource> movable = std::make_shared<MovableResource>();
+    movable->bufferCreateInfo = createInfo;
+    movable->bufferCreateInfo.pNext = nullptr;
+    if (createInfo.sharingMode == VK_SHARING_MODE_CONCURRENT) {
+        movable->queueFamilyIndices.assign(createInfo.pQueueFamilyIndices,
+                                           createInfo.pQueueFamilyIndices + createInfo.queueFamilyIndexCount);
+    }
+    movable->onBufferMove = onMove;
+
+    std::lock_guard<std::mutex> lock(mInfoMutex);
+    mAllocations.get(handle).movable = movable;
+}
+
+void MemoryManager::setImageMovable(AllocationHandle handle, const VkImageCreateInfo& createInfo, VkImageLayout layout,
+                                    ImageMoveCallback onMove) {
+    VkImageUsageFlags transferUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if ((createInfo.usage & transferUsage) != transferUsage) {
+        throw std::runtime_error("A movable image must be a transfer source and destination");
+    }
+
+    std::shared_ptr<MovableResource> movable = std::make_shared<MovableResource>();
+    movable->imageCreateInfo = createInfo;
+    movable->imageCreateInfo.pNext = nullptr;
+    movable->imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (createInfo.sharingMode == VK_SHARING_MODE_CONCURRENT) {
+        movable->queueFamilyIndices.assign(createInfo.pQueueFamilyIndices,
+                                           createInfo.pQueueFamilyIndices + createInfo.queueFamilyIndexCount);
+    }
+    movable->layout = layout;
+    movable->onImageMove = onMove;
+
+    std::lock_guard<std::mutex> lock(mInfoMutex);
+    mAllocations.get(handle).movable = movable;
+}
+
+void MemoryManager::flushThreadCaches() {
+    std::shared_lock<std::shared_mutex> cachesLock(mThreadCachesMutex);
+    for (auto& pair : mThreadCaches) {
+        ThreadCache& cache = *pair.second;
+        std::lock_guard<std::mutex> cacheLock(cache.mutex);
+        for (uint32_t i{0};i < mMemoryProperties.memoryTypeCount;++i) {
+            for (uint32_t j{0};j < ThreadCache::SizeClassCount;++j) {
+                flushThreadCache(cache, i, j, cache.blocks[i][j].size());
+            }
+        }
+    }
+}
+
+size_t MemoryManager::getInternalFragmentation(uint32_t memoryTypeIndex) const {
+    size_t fragmentation{0};
+    std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[memoryTypeIndex]);
+    auto it = mChunksMap.find(memoryTypeIndex);
+    if (it != mChunksMap.end()) {
+        for (auto& chunk : it->second) {
+            if (chunk) {
+                fragmentation += chunk->getInternalFragmentation();
+            }
+        }
+    }
+    return fragmentation;
+}
+
+BufferInfo MemoryManager::reserve(VkMemoryRequirements& memoryRequirements, const MemoryTypeRequest& request,
+                                  VkBuffer buffer, VkImage image, ResourceTiling tiling) {
+    std::vector<uint32_t> memoryTypes = findMemoryTypes(memoryRequirements.memoryTypeBits, request);
+
+    if (memoryTypes.empty()) {
+        throw std::runtime_error("Unable to find a suitable memory type");
+    }
+
+    bool dedicated = needsDedicatedAllocation(memoryRequirements, buffer, image);
+
+    /* When the heap of the best type is exhausted, fall back to the next best one */
+    BufferInfo info;
+    for (uint32_t memoryTypeIndex : memoryTypes) {
+        if (reserveInMemoryType(memoryTypeIndex, memoryRequirements, dedicated, buffer, image, tiling, info)) {
+            return info;
+        }
+    }
+
+    throw std::runtime_error("Unable to find enough memory");
+}
+
+bool MemoryManager::reserveInMemoryType(uint32_t memoryTypeIndex, VkMemoryRequirements& memoryRequirements, bool dedicated,
+                                        VkBuffer buffer, VkImage image, ResourceTiling tiling, BufferInfo& info) {
+    info.memoryTypeIndex = memoryTypeIndex;
+
+    /* Lazily allocated memory is only committed when used, sharing it in a chunk would commit it all */
+    if (mMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+        dedicated = true;
+    }
+
+    /* Thread caches only hold linear blocks, small optimal images are rare enough to take the shared path */
+    uint32_t sizeClass = SlabAllocator::getSizeClass(std::max(memoryRequirements.size, memoryRequirements.alignment));
+    if (!dedicated && tiling == ResourceTiling::Linear && sizeClass < ThreadCache::SizeClassCount) {
+        return reserveFromThreadCache(memoryTypeIndex, sizeClass, memoryRequirements.size, info);
+    }
+
+    std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[memoryTypeIndex]);
+    if (dedicated) {
+        info.chunkIndex = allocateDedicated(memoryTypeIndex, memoryRequirements.size, buffer, image);
+        if (info.chunkIndex == NoChunk) {
+            return false;
         }
+        info.block = mChunksMap[memoryTypeIndex][info.chunkIndex]->reserve(memoryRequirements.size).block;
+        updateUsage(memoryTypeIndex);
+        return true;
+    }
+
+    if (reserveInExistingChunks(memoryTypeIndex, memoryRequirements, tiling, info)) {
+        updateUsage(memoryTypeIndex);
+        return true;
     }
 
     // If we come to this point, this means we need to allocate a new Chunk of memory because the previous one are full
-    allocate(memoryTypeIndex);
-    Chunk& chunk = mChunksMap[memoryTypeIndex].back();
-    AllocationResult result = chunk.reserve(memoryRequirements.size);
-    if (result.found) {
-        Block block = result.block;
-        //mBuffersInfo[buffer] = {}; // For testing purpose
-        mImagesInfo[image].block = block;
-        mImagesInfo[image].chunkIndex = mChunksMap[memoryTypeIndex].size() - 1;
-        mImagesInfo[image].memoryTypeIndex = memoryTypeIndex;
-
-        vkBindImageMemory(mDevice, image, chunk.getMemory(), block.offset);
+    uint32_t chunkIndex = allocate(memoryTypeIndex, memoryRequirements.size + memoryRequirements.alignment - 1, tiling);
+    if (chunkIndex == NoChunk) {
+        return false;
+    }
+
+    AllocationResult result = mChunksMap[memoryTypeIndex][chunkIndex]->reserve(memoryRequirements.size, memoryRequirements.alignment);
+    if (!result.found) {
+        return false;
+    }
+
+    info.block = result.block;
+    info.chunkIndex = chunkIndex;
+    updateUsage(memoryTypeIndex);
+    return true;
+}
+
+void MemoryManager::release(const BufferInfo& info) {
+    if (info.cached) {
+        mSlabRequestedBytes[info.memoryTypeIndex] -= info.block.requestedSize;
+
+        ThreadCache& cache = getThreadCache();
+        uint32_t sizeClass = SlabAllocator::getSizeClass(info.block.size);
+        std::lock_guard<std::mutex> cacheLock(cache.mutex);
+        std::vector<BufferInfo>& blocks = cache.blocks[info.memoryTypeIndex][sizeClass];
+        blocks.push_back(info);
+        blocks.back().block.requestedSize = 0;
+        if (blocks.size() > ThreadCache::MaximumBlockCount) {
+            flushThreadCache(cache, info.memoryTypeIndex, sizeClass, ThreadCache::BatchSize);
+        }
         return;
     }
 
-    throw std::runtime_error("Unable to find enough memory");
+    std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[info.memoryTypeIndex]);
+    freeBlock(info);
+    updateUsage(info.memoryTypeIndex);
 }
 
-void MemoryManager::freeBuffer(VkBuffer buffer) {
-    BufferInfo bufferInfo = mBuffersInfo[buffer];
+void MemoryManager::freeBlock(const BufferInfo& info) {
+    /* A slot only goes back to its slab, the slab block itself is freed once it is empty */
+    BufferInfo blockInfo = info;
+    if (info.slab && !mSlabAllocators[info.memoryTypeIndex].free(info, blockInfo)) {
+        return;
+    }
 
-    if (!mChunksMap[bufferInfo.memoryTypeIndex][bufferInfo.chunkIndex].free(bufferInfo.block)) {
+    if (!mChunksMap[blockInfo.memoryTypeIndex][blockInfo.chunkIndex]->free(blockInfo.block)) {
         throw std::runtime_error("Unable to find the block to free");
     }
+    releaseChunkIfUnused(blockInfo.memoryTypeIndex, blockInfo.chunkIndex);
+}
 
-    mBuffersInfo.erase(buffer);
+bool MemoryManager::reserveInSlab(uint32_t memoryTypeIndex, uint32_t sizeClass, VkDeviceSize requestedSize, BufferInfo& info) {
+    SlabAllocator& slabAllocator = mSlabAllocators[memoryTypeIndex];
+    if (slabAllocator.reserve(sizeClass, requestedSize, info)) {
+        return true;
+    }
 
-    vkDestroyBuffer(mDevice, buffer, nullptr);
+    /* Every slot is full, carve a new slab out of the chunks */
+    if (!addSlab(memoryTypeIndex, sizeClass)) {
+        return false;
+    }
+    return slabAllocator.reserve(sizeClass, requestedSize, info);
 }
 
-void MemoryManager::freeImage(VkImage image) {
-    BufferInfo imageInfo = mImagesInfo[image];
+bool MemoryManager::addSlab(uint32_t memoryTypeIndex, uint32_t sizeClass) {
+    VkMemoryRequirements slabRequirements{};
+    slabRequirements.size = SlabAllocator::SlabSize;
+    slabRequirements.alignment = SlabAllocator::SlabSize;
 
-    if (!mChunksMap[imageInfo.memoryTypeIndex][imageInfo.chunkIndex].free(imageInfo.block)) {
-        throw std::runtime_error("Unable to find the block to free");
+    BufferInfo slabInfo;
+    if (!reserveInExistingChunks(memoryTypeIndex, slabRequirements, ResourceTiling::Linear, slabInfo)) {
+        uint32_t chunkIndex = allocate(memoryTypeIndex, slabRequirements.size, ResourceTiling::Linear);
+        if (chunkIndex == NoChunk) {
+            return false;
+        }
+        AllocationResult result = mChunksMap[memoryTypeIndex][chunkIndex]->reserve(slabRequirements.size,
+                                                                                   slabRequirements.alignment);
+        if (!result.found) {
+            return false;
+        }
+        slabInfo.memoryTypeIndex = memoryTypeIndex;
+        slabInfo.block = result.block;
+        slabInfo.chunkIndex = chunkIndex;
     }
 
-    mImagesInfo.erase(image);
-    
-    vkDestroyImage(mDevice, image, nullptr);
+    SlabAllocator& slabAllocator = mSlabAllocators[memoryTypeIndex];
+    slabAllocator.addSlab(sizeClass, slabInfo);
+
+    uint32_t& peakSlabCount = mRecordedProfile.types[memoryTypeIndex].slabCounts[sizeClass];
+    peakSlabCount = std::max(peakSlabCount, slabAllocator.getSlabCount(sizeClass));
+    return true;
 }
 
-void MemoryManager::mapMemory(VkBuffer buffer, VkDeviceSize size, void** data) {
-    BufferInfo bufferInfo = mBuffersInfo[buffer];
-    vkMapMemory(
-        mDevice,
-        mChunksMap[bufferInfo.memoryTypeIndex][bufferInfo.chunkIndex].getMemory(),
-        bufferInfo.block.offset,
-        size, 0, data);
+AllocationHandle MemoryManager::registerAllocation(const BufferInfo& info, VkBuffer buffer, VkImage image,
+                                                   const std::string& name, VkDeviceSize size) {
+    AllocationRecord record;
+    record.info = info;
+    record.buffer = buffer;
+    record.image = image;
+    record.size = size;
+    record.frame = mFrame;
+    record.time = std::chrono::steady_clock::now();
+
+    Chunk& chunk = getChunk(info);
+    record.memory = chunk.getMemory();
+    if (chunk.getMappedPointer() != nullptr) {
+        record.mappedPointer = static_cast<uint8_t*>(chunk.getMappedPointer()) + info.block.offset;
+    }
+
+    std::lock_guard<std::mutex> lock(mInfoMutex);
+    record.nameId = mNames.intern(name);
+    mNames.add(record.nameId, size);
+    return mAllocations.insert(record);
 }
 
-void MemoryManager::unmapMemory(VkBuffer buffer) {
-    BufferInfo bufferInfo = mBuffersInfo[buffer];
-    vkUnmapMemory(mDevice, mChunksMap[bufferInfo.memoryTypeIndex][bufferInfo.chunkIndex].getMemory());
+Chunk& MemoryManager::getChunk(const BufferInfo& info) {
+    /* The chunk itself can't go away while it holds the block, only the list needs the lock */
+    std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[info.memoryTypeIndex]);
+    return *mChunksMap[info.memoryTypeIndex][info.chunkIndex];
+}
+
+ThreadCache& MemoryManager::getThreadCache() {
+    std::thread::id threadId = std::this_thread::get_id();
+    {
+        std::shared_lock<std::shared_mutex> lock(mThreadCachesMutex);
+        auto it = mThreadCaches.find(threadId);
+        if (it != mThreadCaches.end()) {
+            return *it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mThreadCachesMutex);
+    std::unique_ptr<ThreadCache>& cache = mThreadCaches[threadId];
+    if (!cache) {
+        cache = std::make_unique<ThreadCache>();
+    }
+    return *cache;
 }
 
-int32_t MemoryManager::findMemoryType(VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags& properties) {
-    int32_t memoryTypeIndex = -1;
+bool MemoryManager::reserveFromThreadCache(uint32_t memoryTypeIndex, uint32_t sizeClass, VkDeviceSize requestedSize,
+                                           BufferInfo& info) {
+    ThreadCache& cache = getThreadCache();
+    std::lock_guard<std::mutex> cacheLock(cache.mutex);
+    std::vector<BufferInfo>& blocks = cache.blocks[memoryTypeIndex][sizeClass];
 
-    for (size_t i{0};i < mMemoryProperties.memoryTypeCount;++i) {
-        if (memoryRequirements.memoryTypeBits & (1 << i)) {
-            if ((properties & mMemoryProperties.memoryTypes[i].propertyFlags) == properties){
-                memoryTypeIndex = i;
+    if (blocks.empty()) {
+        /**
+         * Refill a whole batch at once so that the memory type lock is only
+         * taken once in a while. A cached slot is requested by nobody until it
+         * is handed out.
+         */
+        std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[memoryTypeIndex]);
+        for (uint32_t i{0};i < ThreadCache::BatchSize;++i) {
+            BufferInfo blockInfo;
+            if (!reserveInSlab(memoryTypeIndex, sizeClass, 0, blockInfo)) {
                 break;
             }
+            blockInfo.cached = true;
+            blocks.push_back(blockInfo);
+        }
+        updateUsage(memoryTypeIndex);
+
+        if (blocks.empty()) {
+            return false;
         }
     }
 
-    return memoryTypeIndex;
-}
\ No newline at end of file
+    info = blocks.back();
+    blocks.pop_back();
+    info.block.requestedSize = requestedSize;
+    mSlabRequestedBytes[memoryTypeIndex] += requestedSize;
+    return true;
+}
+
+void MemoryManager::flushThreadCache(ThreadCache& cache, uint32_t memoryTypeIndex, uint32_t sizeClass, size_t count) {
+    std::vector<BufferInfo>& blocks = cache.blocks[memoryTypeIndex][sizeClass];
+    if (count == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[memoryTypeIndex]);
+    for (size_t i{0};i < count && !blocks.empty();++i) {
+        freeBlock(blocks.back());
+        blocks.pop_back();
+    }
+    updateUsage(memoryTypeIndex);
+}
+
+void MemoryManager::updateUsage(uint32_t memoryTypeIndex) {
+    VkDeviceSize usedBytes{0};
+    for (auto& chunk : mChunksMap[memoryTypeIndex]) {
+        if (chunk) {
+            usedBytes += chunk->getUsedSize();
+        }
+    }
+    mUsedBytes[memoryTypeIndex] = usedBytes;
+
+    /* Other memory types are read without their lock, a slightly stale value is fine for a peak */
+    uint32_t heapIndex = mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    VkDeviceSize heapUsedBytes{0}, totalUsedBytes{0};
+    for (uint32_t i{0};i < mMemoryProperties.memoryTypeCount;++i) {
+        totalUsedBytes += mUsedBytes[i];
+        if (mMemoryProperties.memoryTypes[i].heapIndex == heapIndex) {
+            heapUsedBytes += mUsedBytes[i];
+        }
+    }
+
+    updatePeak(mPeakUsedBytes[memoryTypeIndex], usedBytes);
+    updatePeak(mHeapPeakUsedBytes[heapIndex], heapUsedBytes);
+    updatePeak(mTotalPeakUsedBytes, totalUsedBytes);
+}
+
+void MemoryManager::updatePeak(std::atomic<VkDeviceSize>& peak, VkDeviceSize value) {
+    VkDeviceSize current = peak.load();
+    while (current < value && !peak.compare_exchange_weak(current, value)) {
+    }
+}
+
+MemoryUsageStatistics MemoryManager::getChunksStatistics(uint32_t memoryTypeIndex) {
+    MemoryUsageStatistics statistics;
+    std::vector<Block> freeBlocks;
+
+    std::lock_guard<std::mutex> lock(mMemoryTypeMutexes[memoryTypeIndex]);
+    for (auto& chunk : mChunksMap[memoryTypeIndex]) {
+        if (!chunk) {
+            continue;
+        }
+        statistics.reservedBytes += chunk->getSize();
+        statistics.usedBytes += chunk->getUsedSize();
+        statistics.requestedBytes += chunk->getRequestedSize();
+        statistics.chunkCount++;
+        if (chunk->getStrategy() == AllocationStrategy::Dedicated) {
+            statistics.dedicatedChunkCount++;
+            continue;
+        }
+
+        freeBlocks.clear();
+        chunk->getFreeBlocks(freeBlocks);
+        statistics.freeBlockCount += freeBlocks.size();
+        for (Block& block : freeBlocks) {
+            statistics.largestFreeBlock = std::max(statistics.largestFreeBlock, static_cast<VkDeviceSize>(block.size));
+        }
+    }
+    /* A slab is one block of its chunk, what is requested in it is what its handed out slots hold */
+    for (uint32_t i{0};i < SlabAllocator::SizeClassCount;++i) {
+        statistics.requestedBytes -= mSlabAllocators[memoryTypeIndex].getSlabCount(i) * SlabAllocator::SlabSize;
+    }
+    statistics.requestedBytes += mSlabRequestedBytes[memoryTypeIndex];
+    statistics.internalFragmentation = statistics.usedBytes - statistics.requestedBytes;
+    statistics.peakUsedBytes = mPeakUsedBytes[memoryTypeIndex];
+    return statistics;
+}
+
+void MemoryManager::accumulate(MemoryUsageStatistics& total, const MemoryUsageStatistics& statistics) {
+    total.reservedBytes += statistics.reservedBytes;
+    total.usedBytes += statistics.usedBytes;
+    total.requestedBytes += statistics.requestedBytes;
+    total.internalFragmentation += statistics.internalFragmentation;
+    total.largestFreeBlock = std::max(total.largestFreeBlock, statistics.largestFreeBlock);
+    total.chunkCount += statistics.chunkCount;
+    total.dedicatedChunkCount += statistics.dedicatedChunkCount;
+    total.allocationCount += statistics.allocationCount;
+    total.freeBlockCount += statistics.freeBlockCount;
+}
+
+void MemoryManager::computeExternalFragmentation(MemoryUsageStatistics& statistics) {
+    /* A dedicated chunk is always full, so the free bytes all belong to pooled chunks */
+    VkDeviceSize freeBytes = statistics.reservedBytes - statistics.usedBytes;
+    statistics.externalFragmentation = freeBytes == 0 ? 0.0f :
+        1.0f - static_cast<float>(statistics.largestFreeBlock) / static_cast<float>(freeBytes);
+}
+
+bool MemoryManager::reserveInExistingChunks(uint32_t memoryTypeIndex, VkMemoryRequirements& memoryRequirements, ResourceTiling tiling,
+                                            BufferInfo& info, uint32_t excludedChunkIndex) {
+    std::vector<std::unique_ptr<Chunk>>& chunks = mChunksMap[memoryTypeIndex];
+    for (uint32_t i{0};i < chunks.size();++i) {
+        if (i == excludedChunkIndex || !chunks[i] || chunks[i]->getStrategy() == AllocationStrategy::Dedicated) {
+            continue;
+        }
+        /* Keeping each tiling in its own chunks means no block ever needs granularity padding */
+        if (mSeparateTilings && chunks[i]->getTiling() != tiling) {
+            continue;
+        }
+        AllocationResult result = chunks[i]->reserve(memoryRequirements.size, memoryRequirements.alignment);
+        if (result.found) {
+            info.memoryTypeIndex = memoryTypeIndex;
+            info.block = result.block;
+            info.chunkIndex = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<uint32_t> MemoryManager::findMemoryTypes(uint32_t memoryTypeBits, const MemoryTypeRequest& request) const {
+    std::vector<uint32_t> memoryTypes;
+    for (uint32_t i{0};i < mMemoryProperties.memoryTypeCount;++i) {
+        VkMemoryPropertyFlags flags = mMemoryProperties.memoryTypes[i].propertyFlags;
+        bool protectedMemory = (flags & VK_MEMORY_PROPERTY_PROTECTED_BIT) && !(request.requiredFlags & VK_MEMORY_PROPERTY_PROTECTED_BIT);
+        if ((memoryTypeBits & (1u << i)) && (flags & request.requiredFlags) == request.requiredFlags && !protectedMemory) {
+            memoryTypes.push_back(i);
+        }
+    }
+
+    /* Rank by the preferred flags present minus the unwanted ones, then by heap size */
+    auto score = [this, &request](uint32_t memoryTypeIndex) {
+        VkMemoryPropertyFlags flags = mMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+        return __builtin_popcount(flags & request.preferredFlags) - __builtin_popcount(flags & request.unwantedFlags);
+    };
+    auto heapSize = [this](uint32_t memoryTypeIndex) {
+        return mMemoryProperties.memoryHeaps[mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+    };
+    std::stable_sort(memoryTypes.begin(), memoryTypes.end(), [&score, &heapSize](uint32_t a, uint32_t b) {
+        if (score(a) != score(b)) {
+            return score(a) > score(b);
+        }
+        return heapSize(a) > heapSize(b);
+    });
+
+    return memoryTypes;
+}
+
+MemoryTypeRequest MemoryManager::getMemoryTypeRequest(MemoryUsage usage) {
+    MemoryTypeRequest request;
+    request.unwantedFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+    switch (usage) {
+        case MemoryUsage::GpuOnly:
+            request.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            request.unwantedFlags |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+            break;
+        case MemoryUsage::CpuToGpu:
+            request.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            request.unwantedFlags |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            break;
+        case MemoryUsage::GpuToCpu:
+            request.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            request.preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+            break;
+        case MemoryUsage::FrameConstants:
+            request.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            request.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            break;
+        case MemoryUsage::Transient:
+            request.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+            request.unwantedFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+            break;
+    }
+
+    return request;
+}
@@ -0,0 +1,142 @@
+#include "memory/SlabAllocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+uint32_t SlabAllocator::getSizeClass(VkDeviceSize size) {
+    uint32_t sizeClass{0};
+    while ((MinimumSize << sizeClass) < size) {
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+VkDeviceSize SlabAllocator::getClassSize(uint32_t sizeClass) {
+    return MinimumSize << sizeClass;
+}
+
+bool SlabAllocator::reserve(uint32_t sizeClass, VkDeviceSize requestedSize, BufferInfo& info) {
+    std::vector<uint32_t>& partialSlabs = mPartialSlabs[sizeClass];
+    if (partialSlabs.empty()) {
+        return false;
+    }
+
+    uint32_t slabIndex = partialSlabs.back();
+    Slab& slab = mSlabs[slabIndex];
+
+    uint32_t word{0};
+    while (slab.freeBits[word] == 0) {
+        word++;
+    }
+    uint32_t bit = __builtin_ctzll(slab.freeBits[word]);
+    slab.freeBits[word] &= ~(uint64_t(1) << bit);
+
+    if (--slab.freeCount == 0) {
+        removePartial(slabIndex);
+    }
+
+    /* Slabs are aligned on their size, so every slot is aligned on its class size */
+    VkDeviceSize classSize = getClassSize(sizeClass);
+    info.memoryTypeIndex = slab.info.memoryTypeIndex;
+    info.chunkIndex = slab.info.chunkIndex;
+    info.block = Block(classSize, slab.info.block.offset + (word * 64 + bit) * classSize);
+    info.block.requestedSize = requestedSize;
+    info.block.free = false;
+    info.slab = true;
+    return true;
+}
+
+void SlabAllocator::addSlab(uint32_t sizeClass, const BufferInfo& slabInfo) {
+    if (slabInfo.block.offset % SlabSize != 0 || slabInfo.block.size < SlabSize) {
+        throw std::runtime_error("Error ! A slab must be a block of at least 'SlabSize' aligned on it.");
+    }
+
+    uint32_t slabIndex;
+    if (!mUnusedSlabs.empty()) {
+        slabIndex = mUnusedSlabs.back();
+        mUnusedSlabs.pop_back();
+    } else {
+        slabIndex = static_cast<uint32_t>(mSlabs.size());
+        mSlabs.emplace_back();
+    }
+
+    Slab& slab = mSlabs[slabIndex];
+    slab.info = slabInfo;
+    slab.sizeClass = sizeClass;
+    slab.slotCount = static_cast<uint32_t>(SlabSize / getClassSize(sizeClass));
+    slab.freeCount = slab.slotCount;
+    slab.partialPosition = InvalidIndex;
+    slab.freeBits.fill(0);
+    for (uint32_t i{0};i < slab.slotCount;i += 64) {
+        uint32_t count = std::min(slab.slotCount - i, 64u);
+        slab.freeBits[i / 64] = count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+    }
+
+    mSlabIndices[getKey(slabInfo.chunkIndex, slabInfo.block.offset)] = slabIndex;
+    mSlabCounts[sizeClass]++;
+    addPartial(slabIndex);
+}
+
+bool SlabAllocator::free(const BufferInfo& info, BufferInfo& emptySlabInfo) {
+    auto it = mSlabIndices.find(getKey(info.chunkIndex, info.block.offset));
+    if (it == mSlabIndices.end()) {
+        throw std::runtime_error("Unable to find the slab of the block to free");
+    }
+
+    uint32_t slabIndex = it->second;
+    Slab& slab = mSlabs[slabIndex];
+    uint32_t slot = static_cast<uint32_t>((info.block.offset - slab.info.block.offset) / getClassSize(slab.sizeClass));
+    uint64_t mask = uint64_t(1) << (slot % 64);
+    if (slab.freeBits[slot / 64] & mask) {
+        throw std::runtime_error("Unable to free a slab slot twice");
+    }
+    slab.freeBits[slot / 64] |= mask;
+
+    if (slab.freeCount++ == 0) {
+        addPartial(slabIndex);
+    }
+
+    /* Hand an empty slab back so that its block can go back to the chunk */
+    if (slab.freeCount == slab.slotCount) {
+        removePartial(slabIndex);
+        emptySlabInfo = slab.info;
+        mSlabIndices.erase(it);
+        mSlabCounts[slab.sizeClass]--;
+        mUnusedSlabs.push_back(slabIndex);
+        return true;
+    }
+    return false;
+}
+
+void SlabAllocator::clear() {
+    mSlabs.clear();
+    mUnusedSlabs.clear();
+    for (std::vector<uint32_t>& partialSlabs : mPartialSlabs) {
+        partialSlabs.clear();
+    }
+    mSlabIndices.clear();
+    mSlabCounts.fill(0);
+}
+
+uint32_t SlabAllocator::getSlabCount(uint32_t sizeClass) const {
+    return mSlabCounts[sizeClass];
+}
+
+void SlabAllocator::addPartial(uint32_t slabIndex) {
+    std::vector<uint32_t>& partialSlabs = mPartialSlabs[mSlabs[slabIndex].sizeClass];
+    mSlabs[slabIndex].partialPosition = static_cast<uint32_t>(partialSlabs.size());
+    partialSlabs.push_back(slabIndex);
+}
+
+void SlabAllocator::removePartial(uint32_t slabIndex) {
+    std::vector<uint32_t>& partialSlabs = mPartialSlabs[mSlabs[slabIndex].sizeClass];
+    uint32_t position = mSlabs[slabIndex].partialPosition;
+    partialSlabs[position] = partialSlabs.back();
+    mSlabs[partialSlabs[position]].partialPosition = position;
+    partialSlabs.pop_back();
+    mSlabs[slabIndex].partialPosition = InvalidIndex;
+}
+
+uint64_t SlabAllocator::getKey(uint32_t chunkIndex, size_t offset) {
+    return (static_cast<uint64_t>(chunkIndex) << 32) | (offset / SlabSize);
+}
@@ -0,0 +1,255 @@
+#include "memory/TlsfAllocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+TlsfAllocator::TlsfAllocator(const size_t size, const size_t granularity) :
+    mSize(size), mGranularity(granularity) {
+    if (!Block::isPowerOfTwo(granularity) || granularity == 0 || size % granularity != 0) {
+        throw std::runtime_error("Error ! 'granularity' must be a power of two dividing 'size'.");
+    }
+
+    uint32_t firstLevel, secondLevel;
+    mapping(size / granularity, firstLevel, secondLevel);
+    mFirstLevelCount = firstLevel + 1;
+    if (mFirstLevelCount > 32) {
+        throw std::runtime_error("Error ! 'size' is too big for the chosen granularity.");
+    }
+
+    mSecondLevelBitmaps.assign(mFirstLevelCount, 0);
+    mFreeListHeads.assign(mFirstLevelCount * SecondLevelCount, InvalidIndex);
+    mNodes.reserve(64);
+
+    uint32_t nodeIndex = createNode(0, size);
+    insertFree(nodeIndex);
+}
+
+AllocationResult TlsfAllocator::reserve(const size_t blockSize, const size_t alignment) {
+    AllocationResult result;
+    result.found = false;
+
+    size_t units = (std::max(blockSize, size_t(1)) + mGranularity - 1) / mGranularity;
+    size_t alignmentUnits = alignment > mGranularity ? alignment / mGranularity : 1;
+
+    if (units > mSize / mGranularity) {
+        return result;
+    }
+
+    /* Look for a block that fits even in the worst alignment case */
+    uint32_t firstLevel, secondLevel;
+    if (!findSuitable(units + alignmentUnits - 1, firstLevel, secondLevel)) {
+        return result;
+    }
+
+    uint32_t nodeIndex = mFreeListHeads[firstLevel * SecondLevelCount + secondLevel];
+    removeFree(nodeIndex);
+
+    size_t alignmentInBytes = alignmentUnits * mGranularity;
+    size_t alignedOffset = (mNodes[nodeIndex].offset + alignmentInBytes - 1) / alignmentInBytes * alignmentInBytes;
+    size_t padding = alignedOffset - mNodes[nodeIndex].offset;
+    if (padding != 0) {
+        uint32_t alignedIndex = split(nodeIndex, padding);
+        insertFree(nodeIndex);
+        nodeIndex = alignedIndex;
+    }
+
+    size_t size = units * mGranularity;
+    if (mNodes[nodeIndex].size > size) {
+        insertFree(split(nodeIndex, size));
+    }
+
+    mNodes[nodeIndex].free = false;
+    mNodeAtOffset[mNodes[nodeIndex].offset] = nodeIndex;
+
+    result.found = true;
+    result.block = Block(size, mNodes[nodeIndex].offset);
+    result.block.requestedSize = blockSize;
+    result.block.free = false;
+
+    mUsedSize += size;
+    mRequestedSize += blockSize;
+    return result;
+}
+
+bool TlsfAllocator::free(Block block) {
+    auto nodeIt = mNodeAtOffset.find(block.offset);
+    if (nodeIt == mNodeAtOffset.end() || mNodes[nodeIt->second].size != block.size) {
+        return false;
+    }
+
+    uint32_t nodeIndex = nodeIt->second;
+    mNodeAtOffset.erase(nodeIt);
+    mNodes[nodeIndex].free = true;
+    mUsedSize -= block.size;
+    mRequestedSize -= block.requestedSize;
+
+    /* Coalesce with the physical neighbours, so that two free blocks are never adjacent */
+    uint32_t nextIndex = mNodes[nodeIndex].nextPhysical;
+    if (nextIndex != InvalidIndex && mNodes[nextIndex].free) {
+        removeFree(nextIndex);
+        merge(nodeIndex, nextIndex);
+    }
+
+    uint32_t previousIndex = mNodes[nodeIndex].previousPhysical;
+    if (previousIndex != InvalidIndex && mNodes[previousIndex].free) {
+        removeFree(previousIndex);
+        merge(previousIndex, nodeIndex);
+        nodeIndex = previousIndex;
+    }
+
+    insertFree(nodeIndex);
+    return true;
+}
+
+void TlsfAllocator::getFreeBlocks(std::vector<Block>& freeBlocks) const {
+    for (uint32_t nodeIndex = FirstNode;nodeIndex != InvalidIndex;nodeIndex = mNodes[nodeIndex].nextPhysical) {
+        if (mNodes[nodeIndex].free) {
+            freeBlocks.push_back(Block(mNodes[nodeIndex].size, mNodes[nodeIndex].offset));
+        }
+    }
+}
+
+size_t TlsfAllocator::getSize() const {
+    return mSize;
+}
+
+size_t TlsfAllocator::getUsedSize() const {
+    return mUsedSize;
+}
+
+size_t TlsfAllocator::getRequestedSize() const {
+    return mRequestedSize;
+}
+
+void TlsfAllocator::mapping(const size_t units, uint32_t& firstLevel, uint32_t& secondLevel) const {
+    if (units < SecondLevelCount) {
+        firstLevel = 0;
+        secondLevel = static_cast<uint32_t>(units);
+    } else {
+        uint32_t msb = mostSignificantBit(units);
+        secondLevel = static_cast<uint32_t>(units >> (msb - SecondLevelLog2)) - SecondLevelCount;
+        firstLevel = msb - SecondLevelLog2 + 1;
+    }
+}
+
+bool TlsfAllocator::findSuitable(const size_t units, uint32_t& firstLevel, uint32_t& secondLevel) const {
+    /* Round up to the next size class so that any block of the class fits */
+    size_t roundedUnits = units;
+    if (units >= SecondLevelCount) {
+        roundedUnits += (size_t(1) << (mostSignificantBit(units) - SecondLevelLog2)) - 1;
+    }
+    mapping(roundedUnits, firstLevel, secondLevel);
+
+    if (firstLevel >= mFirstLevelCount) {
+        return false;
+    }
+
+    uint32_t secondLevelMap = mSecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0) {
+        uint32_t firstLevelMap = firstLevel + 1 < 32 ? mFirstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0) {
+            return false;
+        }
+        firstLevel = __builtin_ctz(firstLevelMap);
+        secondLevelMap = mSecondLevelBitmaps[firstLevel];
+    }
+    secondLevel = __builtin_ctz(secondLevelMap);
+    return true;
+}
+
+void TlsfAllocator::insertFree(const uint32_t nodeIndex) {
+    uint32_t firstLevel, secondLevel;
+    mapping(mNodes[nodeIndex].size / mGranularity, firstLevel, secondLevel);
+    uint32_t listIndex = firstLevel * SecondLevelCount + secondLevel;
+
+    Node& node = mNodes[nodeIndex];
+    node.free = true;
+    node.previousFree = InvalidIndex;
+    node.nextFree = mFreeListHeads[listIndex];
+    if (node.nextFree != InvalidIndex) {
+        mNodes[node.nextFree].previousFree = nodeIndex;
+    }
+    mFreeListHeads[listIndex] = nodeIndex;
+
+    mFirstLevelBitmap |= 1u << firstLevel;
+    mSecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::removeFree(const uint32_t nodeIndex) {
+    uint32_t firstLevel, secondLevel;
+    mapping(mNodes[nodeIndex].size / mGranularity, firstLevel, secondLevel);
+    uint32_t listIndex = firstLevel * SecondLevelCount + secondLevel;
+
+    Node& node = mNodes[nodeIndex];
+    if (node.previousFree != InvalidIndex) {
+        mNodes[node.previousFree].nextFree = node.nextFree;
+    } else {
+        mFreeListHeads[listIndex] = node.nextFree;
+    }
+    if (node.nextFree != InvalidIndex) {
+        mNodes[node.nextFree].previousFree = node.previousFree;
+    }
+    node.previousFree = InvalidIndex;
+    node.nextFree = InvalidIndex;
+    node.free = false;
+
+    if (mFreeListHeads[listIndex] == InvalidIndex) {
+        mSecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (mSecondLevelBitmaps[firstLevel] == 0) {
+            mFirstLevelBitmap &= ~(1u << firstLevel);
+        }
+    }
+}
+
+uint32_t TlsfAllocator::split(const uint32_t nodeIndex, const size_t size) {
+    uint32_t remainderIndex = createNode(mNodes[nodeIndex].offset + size, mNodes[nodeIndex].size - size);
+
+    Node& node = mNodes[nodeIndex];
+    Node& remainder = mNodes[remainderIndex];
+    remainder.previousPhysical = nodeIndex;
+    remainder.nextPhysical = node.nextPhysical;
+    if (node.nextPhysical != InvalidIndex) {
+        mNodes[node.nextPhysical].previousPhysical = remainderIndex;
+    }
+    node.nextPhysical = remainderIndex;
+    node.size = size;
+
+    return remainderIndex;
+}
+
+void TlsfAllocator::merge(const uint32_t nodeIndex, const uint32_t nextIndex) {
+    Node& node = mNodes[nodeIndex];
+    Node& next = mNodes[nextIndex];
+
+    node.size += next.size;
+    node.nextPhysical = next.nextPhysical;
+    if (next.nextPhysical != InvalidIndex) {
+        mNodes[next.nextPhysical].previousPhysical = nodeIndex;
+    }
+
+    releaseNode(nextIndex);
+}
+
+uint32_t TlsfAllocator::createNode(const size_t offset, const size_t size) {
+    uint32_t nodeIndex;
+    if (!mUnusedNodes.empty()) {
+        nodeIndex = mUnusedNodes.back();
+        mUnusedNodes.pop_back();
+        mNodes[nodeIndex] = Node();
+    } else {
+        nodeIndex = static_cast<uint32_t>(mNodes.size());
+        mNodes.emplace_back();
+    }
+
+    mNodes[nodeIndex].offset = offset;
+    mNodes[nodeIndex].size = size;
+    return nodeIndex;
+}
+
+void TlsfAllocator::releaseNode(const uint32_t nodeIndex) {
+    mUnusedNodes.push_back(nodeIndex);
+}
+
+uint32_t TlsfAllocator::mostSignificantBit(const size_t n) {
+    return 63 - __builtin_clzll(static_cast<unsigned long long>(n));
+}
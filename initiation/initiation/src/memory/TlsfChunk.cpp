@@ -0,0 +1,29 @@
+#include "memory/TlsfChunk.hpp"
+
+size_t TlsfChunk::Granularity = 256;
+
+TlsfChunk::TlsfChunk(VkDeviceMemory memory, const size_t chunkSize, const size_t granularity) :
+    Chunk(memory, chunkSize), mAllocator(chunkSize, granularity) {
+}
+
+AllocationResult TlsfChunk::reserve(const size_t blockSize, const size_t alignment) {
+    AllocationResult result = mAllocator.reserve(blockSize, alignment);
+    mUsedSize = mAllocator.getUsedSize();
+    mRequestedSize = mAllocator.getRequestedSize();
+    return result;
+}
+
+bool TlsfChunk::free(Block block) {
+    bool freed = mAllocator.free(block);
+    mUsedSize = mAllocator.getUsedSize();
+    mRequestedSize = mAllocator.getRequestedSize();
+    return freed;
+}
+
+AllocationStrategy TlsfChunk::getStrategy() const {
+    return AllocationStrategy::Tlsf;
+}
+
+void TlsfChunk::getFreeBlocks(std::vector<Block>& freeBlocks) const {
+    mAllocator.getFreeBlocks(freeBlocks);
+}
@@ -33,6 +33,12 @@ void Renderer::create(VulkanContext& context, TextureManager& textureManager, Me
     mTextureManager = &textureManager;
     mMeshManager = &meshManager;
 
+    /* The indirect path reads the per draw data from a storage buffer instead of a uniform buffer per mesh */
+    if (mMeshManager->isIndirectDrawEnabled()) {
+        mVertexShader = Shader(shaderPath + "indirect_vert.spv", VK_SHADER_STAGE_VERTEX_BIT, "main");
+        mFragmentShader = Shader(shaderPath + "indirect_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "main");
+    }
+
     mSwapChain.query(mContext->getWindow(),
                      mContext->getPhysicalDevice(),
                      mContext->getDevice(),
@@ -49,8 +55,10 @@ void Renderer::create(VulkanContext& context, TextureManager& textureManager, Me
     createDescriptorSetLayout();
     createGraphicsPipeline();
     createDescriptorPool();
-    createCameraUniformBuffers();
-    createCameraDescriptorSets();
+    mContext->getMemoryManager().createFrameAllocator(mSwapChain.getImageCount(),
+        FrameAllocator::DefaultRegionSize + mMeshManager->getFrameDataSize());
+    mDefragmenter.create(*mContext);
+    createCameraDescriptorSet();
     createCommandPools();
     createCommandBuffers();
     createSemaphores();
@@ -67,6 +75,7 @@ void Renderer::recreate() {
     }
     
     vkDeviceWaitIdle(mContext->getDevice());
+    uint32_t imageCount = mSwapChain.getImageCount();
 
     /* Destroying resources that need to be recreated */
 
@@ -97,13 +106,44 @@ void Renderer::recreate() {
     createGraphicsPipeline();
     createCommandBuffers();
     mCamera->setExtent(mSwapChain.getExtent());
+
+    /* The new swap chain may have another image count, and everything indexed by the image follows it */
+    if (mSwapChain.getImageCount() != imageCount) {
+        recreateImageResources();
+    }
+}
+
+void Renderer::recreateImageResources() {
+    /* The device is idle, none of these are used anymore */
+    for (auto& commandPool : mCommandPools) {
+        vkDestroyCommandPool(mContext->getDevice(), commandPool, nullptr);
+    }
+    vkDestroySemaphore(mContext->getDevice(), mImageAvailableSemaphore, nullptr);
+    for (size_t i{0};i < mRenderFinishedSemaphores.size();++i) {
+        vkDestroySemaphore(mContext->getDevice(), mRenderFinishedSemaphores[i], nullptr);
+    }
+    for (size_t i{0};i < mFencesInfo.size();++i) {
+        vkDestroyFence(mContext->getDevice(), mFencesInfo[i].fence, nullptr);
+    }
+    mFencesInfo.clear();
+
+    /* One frame allocator region per image, the sets pointing to its buffer are written again */
+    MemoryManager& memoryManager = mContext->getMemoryManager();
+    memoryManager.createFrameAllocator(mSwapChain.getImageCount(),
+        FrameAllocator::DefaultRegionSize + mMeshManager->getFrameDataSize());
+    memoryManager.flushDeferredReleases();
+    writeCameraDescriptorSet();
+
+    createCommandPools();
+    createSemaphores();
+    createFences();
+    mMeshManager->setImageCount(mSwapChain.getImageCount());
+    mTextureManager->setImageCount(mSwapChain.getImageCount());
 }
 
 void Renderer::destroy() {
     if (mCreated) {
-        for (size_t i{0};i < mSwapChain.getImageCount();++i) {
-            mContext->getMemoryManager().freeBuffer(mCameraUniformBuffers[i]);
-        }
+        mDefragmenter.destroy();
 
         for (auto& framebufferAttachment : mFramebufferAttachments) {
             framebufferAttachment.normal.image.destroy(*mContext);
@@ -151,10 +191,10 @@ void Renderer::render() {
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
     mToWaitSemaphores.push_back(mImageAvailableSemaphore);
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    mToWaitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
     submitInfo.waitSemaphoreCount = mToWaitSemaphores.size();
     submitInfo.pWaitSemaphores = mToWaitSemaphores.data();
-    submitInfo.pWaitDstStageMask = waitStages;
+    submitInfo.pWaitDstStageMask = mToWaitStages.data();
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &mCommandBuffers[mNextImageIndex];
 
@@ -191,13 +231,36 @@ void Renderer::render() {
 void Renderer::update(double dt) {
     acquireNextImage();
 
+    /* Nothing is submitted for this frame, so nothing may be recorded or wait for it either */
+    if (mBypassRendering) {
+        return;
+    }
+
+    /* Once the fence has signaled, what this image used last time can be reused or released */
+    waitForFence();
+    mContext->getMemoryManager().beginFrame(mNextImageIndex);
+    mTextureManager->beginFrame();
+
     mToWaitSemaphores.clear();
+    mToWaitStages.clear();
 
-    mMeshManager->update(mNextImageIndex);
+    /* Before the meshes are recorded, as the moved buffers and images are used from this frame on */
+    VkSemaphore defragmentationSemaphore = mDefragmenter.update();
+    if (defragmentationSemaphore != VK_NULL_HANDLE) {
+        mToWaitSemaphores.push_back(defragmentationSemaphore);
+        mToWaitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+
+    uint32_t cameraOffset = updateUniformBuffer();
+    VkSemaphore geometrySemaphore = mMeshManager->update(mNextImageIndex);
+    if (geometrySemaphore != VK_NULL_HANDLE) {
+        mToWaitSemaphores.push_back(geometrySemaphore);
+        mToWaitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+    }
 
     VkCommandBuffer staticBuffer = mMeshManager->render(
         mRenderPass.getHandler(), mFrameBuffers[mNextImageIndex].getHandler(),
-        mCommandPools[mNextImageIndex], mCameraDescriptorSets[mNextImageIndex],
+        mCommandPools[mNextImageIndex], mCameraDescriptorSet, cameraOffset,
         mPipeline.getLayout().getHandler(), mPipeline.getHandler(), mNextImageIndex);
 
     VkCommandBufferAllocateInfo allocateInfo{};
@@ -231,9 +294,6 @@ void Renderer::update(double dt) {
     vkCmdEndRenderPass(mCommandBuffers[mNextImageIndex]);
 
     vkEndCommandBuffer(mCommandBuffers[mNextImageIndex]);
-
-    updateUniformBuffer(mNextImageIndex);
-    waitForFence();
 }
 
 void Renderer::setCamera(Camera& camera) {
@@ -278,7 +338,7 @@ void Renderer::waitForFence() {
 
 void Renderer::createRenderPass() {
     /* Create framebuffers */
-    mFramebufferAttachments.resize(mSwapChain.getImageCount());
+    mFramebufferAttachments.resize(AttachmentSetCount);
     
     VkMemoryRequirements memoryRequirements;
     VkImageSubresourceRange subresourceRange{};
@@ -286,13 +346,13 @@ void Renderer::createRenderPass() {
         /* Create the normal attachment */
         framebufferAttachment.normal = createAttachment(
             VK_FORMAT_R8G8B8A8_UNORM,
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
             VK_IMAGE_ASPECT_COLOR_BIT);
         
         /* Create the depth attachment */
         framebufferAttachment.depth = createAttachment(
             findDepthFormat(),
-            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
             VK_IMAGE_ASPECT_DEPTH_BIT);
     }
 
@@ -313,7 +373,8 @@ void Renderer::createRenderPass() {
     attachments[1].setFormat(VK_FORMAT_R8G8B8A8_UNORM);
     attachments[1].setSamples(VK_SAMPLE_COUNT_1_BIT);
     attachments[1].setLoadOp(VK_ATTACHMENT_LOAD_OP_CLEAR);
-    attachments[1].setStoreOp(VK_ATTACHMENT_STORE_OP_STORE);
+    /* Nothing reads it after the pass, so it can stay in tile memory */
+    attachments[1].setStoreOp(VK_ATTACHMENT_STORE_OP_DONT_CARE);
     attachments[1].setStencilLoadOp(VK_ATTACHMENT_LOAD_OP_DONT_CARE);
     attachments[1].setStencilStoreOp(VK_ATTACHMENT_STORE_OP_DONT_CARE);
     attachments[1].setInitialLayout(VK_IMAGE_LAYOUT_UNDEFINED);
@@ -349,10 +410,12 @@ void Renderer::createRenderPass() {
     SubpassDependency dependency;
     dependency.setSourceSubpass(VK_SUBPASS_EXTERNAL);
     dependency.setDestinationSubpass(0);
-    dependency.setSourceStageMask(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    dependency.setSourceAccessMask(0);
-    dependency.setDestinationStageMask(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    dependency.setDestinationAccessMask(VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    /* Also waits for the attachment writes of the previous frame, since every frame uses the same attachments */
+    dependency.setSourceStageMask(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT);
+    dependency.setSourceAccessMask(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+    dependency.setDestinationStageMask(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT);
+    dependency.setDestinationAccessMask(VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
 
     mRenderPass.addSubpassDependency(dependency.getDependency());
     
@@ -386,8 +449,8 @@ void Renderer::createFramebuffers() {
     for (size_t i{0}; i < mSwapChain.getImageCount();++i) {
         std::vector<VkImageView> attachments = {
             mSwapChain.getImageView(i),
-            mFramebufferAttachments[i].normal.imageView.getHandler(),
-            mFramebufferAttachments[i].depth.imageView.getHandler(),
+            mFramebufferAttachments[i % AttachmentSetCount].normal.imageView.getHandler(),
+            mFramebufferAttachments[i % AttachmentSetCount].depth.imageView.getHandler(),
         };
 
         mFrameBuffers[i].setRenderPass(mRenderPass.getHandler());
@@ -400,11 +463,13 @@ void Renderer::createFramebuffers() {
 }
 
 void Renderer::createDescriptorPool() {
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     poolSizes[0].descriptorCount = 10000;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     poolSizes[1].descriptorCount = 10000;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[2].descriptorCount = 10000;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -420,7 +485,7 @@ void Renderer::createDescriptorPool() {
 void Renderer::createDescriptorSetLayout() {
     VkDescriptorSetLayoutBinding cameraLayoutBinding{};
     cameraLayoutBinding.binding = 0;
-    cameraLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cameraLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     cameraLayoutBinding.descriptorCount = 1;
     cameraLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     cameraLayoutBinding.pImmutableSamplers = nullptr;
@@ -439,51 +504,34 @@ void Renderer::createCommandBuffers() {
     mCommandBuffers.resize(mSwapChain.getImageCount());
 }
 
-void Renderer::createCameraUniformBuffers() {
-    mCameraUniformBuffers.resize(mSwapChain.getImageCount());
-    VkDeviceSize bufferSize = sizeof(RenderInfo);
-
-    for (size_t i{0};i < mCameraUniformBuffers.size();++i) {
-        BufferHelper::createBuffer(*mContext,
-                               bufferSize,
-                               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                               VK_SHARING_MODE_EXCLUSIVE,
-                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
-                               mCameraUniformBuffers[i],
-                               "Camera Uniform Buffer");
-    }
-}
-
-void Renderer::createCameraDescriptorSets() {
-    mCameraDescriptorSets.resize(mSwapChain.getImageCount());
-
+void Renderer::createCameraDescriptorSet() {
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = mDescriptorPool;
     allocInfo.descriptorSetCount = 1;
     allocInfo.pSetLayouts = &mCameraDescriptorSetLayout;
 
-    for (size_t i{0};i < mCameraDescriptorSets.size();++i) {
-        if (vkAllocateDescriptorSets(mContext->getDevice(), &allocInfo, &mCameraDescriptorSets[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate descriptor sets");
-        }
+    if (vkAllocateDescriptorSets(mContext->getDevice(), &allocInfo, &mCameraDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate descriptor sets");
     }
+    writeCameraDescriptorSet();
+}
 
-    for (size_t i{0};i < mCameraDescriptorSets.size();++i) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = mCameraUniformBuffers[i];
-        bufferInfo.range = sizeof(RenderInfo);
-
-        VkWriteDescriptorSet descriptorWrite{};
-        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = mCameraDescriptorSets[i];
-        descriptorWrite.dstBinding = 0;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = &bufferInfo;
-
-        vkUpdateDescriptorSets(mContext->getDevice(), 1, &descriptorWrite, 0, nullptr);
-    }
+void Renderer::writeCameraDescriptorSet() {
+    /* The camera data is written each frame in the frame allocator, the offset is given when binding */
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = mContext->getMemoryManager().getFrameAllocator().getBuffer();
+    bufferInfo.range = sizeof(RenderInfo);
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = mCameraDescriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(mContext->getDevice(), 1, &descriptorWrite, 0, nullptr);
 }
 
 void Renderer::createSemaphores() {
@@ -545,12 +593,12 @@ FrameBufferAttachment Renderer::createAttachment(VkFormat format,
     attachment.image.setInitialLayout(VK_IMAGE_LAYOUT_UNDEFINED);
     attachment.image.create(*mContext);
     vkGetImageMemoryRequirements(mContext->getDevice(), attachment.image.getHandler(), &memoryRequirements);
-    mContext->getMemoryManager().allocateForImage(
+    attachment.image.setAllocation(mContext->getMemoryManager().allocateForImage(
         attachment.image.getHandler(),
         memoryRequirements,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        MemoryUsage::Transient,
         "attachment"
-    );
+    ));
 
     attachment.imageView.setImageViewType(VK_IMAGE_VIEW_TYPE_2D);
     attachment.imageView.setFormat(format);
@@ -566,17 +614,16 @@ FrameBufferAttachment Renderer::createAttachment(VkFormat format,
     return attachment;
 }
 
-void Renderer::updateUniformBuffer(uint32_t index) {
+uint32_t Renderer::updateUniformBuffer() {
     RenderInfo renderInfo;
     renderInfo.proj = mCamera->getProj();
     renderInfo.view = mCamera->getView();
     renderInfo.cameraPosition = glm::vec4(mCamera->getPosition(), 1.0);
     renderInfo.lightPosition = glm::vec4(mLight->position, 1.0);
 
-    void* data;
-    mContext->getMemoryManager().mapMemory(mCameraUniformBuffers[index], sizeof(RenderInfo), &data);
-    memcpy(data, &renderInfo, sizeof(RenderInfo));
-    mContext->getMemoryManager().unmapMemory(mCameraUniformBuffers[index]);
+    FrameAllocation allocation = mContext->getMemoryManager().getFrameAllocator().allocate(sizeof(RenderInfo));
+    memcpy(allocation.data, &renderInfo, sizeof(RenderInfo));
+    return static_cast<uint32_t>(allocation.offset);
 }
 
 VkFormat Renderer::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
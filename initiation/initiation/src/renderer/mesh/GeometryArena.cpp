@@ -0,0 +1,60 @@
+#include "renderer/mesh/GeometryArena.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+GeometryArena::GeometryArena(uint32_t initialCapacity) {
+    addSegment(initialCapacity);
+}
+
+GeometryRange GeometryArena::allocate(uint32_t count) {
+    GeometryRange range;
+    range.count = count;
+    if (count == 0) {
+        return range;
+    }
+
+    for (uint32_t i{0};i < mSegments.size();++i) {
+        AllocationResult result = mSegments[i].ranges->reserve(count);
+        if (result.found) {
+            range.offset = mSegments[i].base + static_cast<uint32_t>(result.block.offset);
+            range.segment = i;
+            range.block = result.block;
+            return range;
+        }
+    }
+
+    /* Doubling keeps the number of segments, and of buffer copies, logarithmic */
+    addSegment(std::max(mCapacity, count));
+    AllocationResult result = mSegments.back().ranges->reserve(count);
+    if (!result.found) {
+        throw std::runtime_error("Failed to grow the geometry arena");
+    }
+    range.offset = mSegments.back().base + static_cast<uint32_t>(result.block.offset);
+    range.segment = static_cast<uint32_t>(mSegments.size() - 1);
+    range.block = result.block;
+    return range;
+}
+
+void GeometryArena::free(const GeometryRange& range) {
+    if (range.count == 0) {
+        return;
+    }
+    if (range.segment >= mSegments.size() || !mSegments[range.segment].ranges->free(range.block)) {
+        throw std::runtime_error("Trying to free a geometry range that isn't allocated");
+    }
+}
+
+uint32_t GeometryArena::getCapacity() const {
+    return mCapacity;
+}
+
+void GeometryArena::addSegment(uint32_t size) {
+    size = (size + Granularity - 1) / Granularity * Granularity;
+    if (static_cast<uint64_t>(mCapacity) + size > UINT32_MAX) {
+        throw std::runtime_error("The geometry arena can't address more elements");
+    }
+
+    mSegments.push_back({mCapacity, std::make_unique<TlsfAllocator>(size, Granularity)});
+    mCapacity += size;
+}
@@ -0,0 +1,19 @@
+#include "renderer/mesh/MeshInstance.hpp"
+
+MeshInstance::MeshInstance(Mesh& mesh) : mMesh(&mesh) {}
+
+Mesh& MeshInstance::getMesh() {
+    return *mMesh;
+}
+
+Transform& MeshInstance::getTransform() {
+    return mTransform;
+}
+
+Texture& MeshInstance::getTexture() {
+    return mTexture != nullptr ? *mTexture : mMesh->getTexture();
+}
+
+void MeshInstance::setTexture(Texture& texture) {
+    mTexture = &texture;
+}
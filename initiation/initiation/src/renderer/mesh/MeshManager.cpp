@@ -1,53 +1,93 @@
 #include <iostream>
+#include <algorithm>
 
 #include "renderer/mesh/MeshManager.hpp"
 #include "vulkan/buffer/BufferHelper.hpp"
+#include "resources/TextureManager.hpp"
+#include "utils/Hash.hpp"
 #include "tools/Profiler.hpp"
 
 MeshManager::MeshManager() {
     mMeshes.reserve(MaximumMeshCount);
 }
 
-void MeshManager::create(VulkanContext& context) {
+void MeshManager::create(VulkanContext& context, TextureManager& textureManager) {
     mContext = &context;
+    mTextureManager = &textureManager;
+
+    /* Otherwise the meshes are drawn one by one, each with its own descriptor set */
+    VkPhysicalDeviceFeatures features = mContext->getEnabledFeatures();
+    VkPhysicalDeviceLimits limits = mContext->getLimits();
+    mIndirectDraw = features.multiDrawIndirect && features.drawIndirectFirstInstance &&
+                    features.shaderSampledImageArrayDynamicIndexing &&
+                    limits.maxDrawIndirectCount >= MaximumDrawDataCount &&
+                    limits.maxPerStageDescriptorSamplers >= MaximumTextureCount &&
+                    limits.maxPerStageDescriptorSampledImages >= MaximumTextureCount;
+
     createDescriptorSetLayout();
-    allocateUniformBuffer();
     allocateDescriptorSets();
+    createTransferSynchronization();
+    if (mIndirectDraw) {
+        createIndirectDescriptorSetLayout();
+    }
+
+    /* The geometry blocks may be compacted, the draws recorded from now on use the new buffer */
+    mContext->getMemoryManager().getBufferPool(BufferClass::Geometry).setMoveCallback(
+        [this](VkBuffer oldBuffer, VkBuffer newBuffer) {
+            GeometryBuffers& buffers = mRenderData.geometryBuffers;
+            if (buffers.vertexBuffer.buffer == oldBuffer) {
+                buffers.vertexBuffer.buffer = newBuffer;
+            }
+            if (buffers.indexBuffer.buffer == oldBuffer) {
+                buffers.indexBuffer.buffer = newBuffer;
+            }
+        });
 }
 
 void MeshManager::destroy() {
     vkDestroyDescriptorSetLayout(mContext->getDevice(), mRenderData.descriptorSetLayout, nullptr);
-    for (auto& buffers : mRenderData.renderBuffers) {
-        if (buffers.vertexBufferSizeInBytes != 0)
-            mContext->getMemoryManager().freeBuffer(buffers.vertexBuffer);
-        if (buffers.indexBufferSizeInBytes != 0)
-            mContext->getMemoryManager().freeBuffer(buffers.indexBuffer);
+    if (mRenderData.indirectDescriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(mContext->getDevice(), mRenderData.indirectDescriptorSetLayout, nullptr);
     }
 
-    if (mRenderData.stagingBuffers.vertexBufferSizeInBytes != 0)
-        mContext->getMemoryManager().freeBuffer(mRenderData.stagingBuffers.vertexBuffer);
-    if (mRenderData.stagingBuffers.indexBufferSizeInBytes != 0)
-        mContext->getMemoryManager().freeBuffer(mRenderData.stagingBuffers.indexBuffer);
+    BufferPool& geometryPool = mContext->getMemoryManager().getBufferPool(BufferClass::Geometry);
+    geometryPool.free(mRenderData.geometryBuffers.vertexBuffer);
+    geometryPool.free(mRenderData.geometryBuffers.indexBuffer);
+    mRenderData.geometryBuffers = GeometryBuffers{};
+
+    BufferPool& stagingPool = mContext->getMemoryManager().getBufferPool(BufferClass::Staging);
+    for (GeometryUpload& upload : mUploads) {
+        stagingPool.free(upload.staging);
+    }
+    mUploads.clear();
 
-    mContext->getMemoryManager().freeBuffer(mRenderData.modelTransformBuffer);
+    if (mTransferCommandBuffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(mContext->getDevice(), mContext->getTransferCommandPool().getHandler(), 1, &mTransferCommandBuffer);
+        mTransferCommandBuffer = VK_NULL_HANDLE;
+    }
+    vkDestroyFence(mContext->getDevice(), mTransferCompleteFence, nullptr);
+    vkDestroySemaphore(mContext->getDevice(), mTransferCompleteSemaphore, nullptr);
 
-    for (size_t i{0};i < mTransferCompleteFences.size();++i) {
-        vkDestroyFence(mContext->getDevice(), mTransferCompleteFences[i], nullptr);
+    for (size_t i{0};i < mEvents.size();++i) {
         vkDestroyEvent(mContext->getDevice(), mEvents[i], nullptr);
     }
+    mRenderData.geometries.clear();
+    mRenderData.geometryBindings.clear();
 }
 
 void MeshManager::addMesh(Mesh& mesh) {
-    assert(mMeshes.size() + mTemporaryMeshes.size() < MaximumMeshCount);
-    mTemporaryMeshes.push_back(&mesh);
+    assert(mMeshes.size() < MaximumMeshCount);
+    mMeshes.push_back(&mesh);
 
     auto meshDataIt = std::find_if(mRenderData.meshDataPool.begin(), mRenderData.meshDataPool.end(),
                                      [](const MeshData& data) { return data.free; });
     assert(meshDataIt != mRenderData.meshDataPool.end());
     meshDataIt->free = false;
     mRenderData.meshDataBinding[&mesh] = &(*meshDataIt);
+    mTextureManager->use(mesh.getTexture());
     updateDescriptorSet(mesh, *meshDataIt);
-    mNeedStagingUpdate = true;
+    meshDataIt->textureIndex = acquireTextureSlot(mesh.getTexture());
+    meshDataIt->geometry = acquireGeometry(mesh);
 }
 
 void MeshManager::removeMesh(Mesh& mesh) {
@@ -60,78 +100,114 @@ void MeshManager::removeMesh(Mesh& mesh) {
                                      [&descriptorSet](const MeshData& data) { return data.descriptorSet == descriptorSet; });
     descriptorIt->free = true;
     mRenderData.meshDataBinding.erase(&mesh);
-    mNeedStagingUpdate = true;
+    releaseTextureSlot(descriptorIt->textureIndex);
+    releaseGeometry(mesh);
+    descriptorIt->geometry = nullptr;
+}
+
+void MeshManager::addInstance(MeshInstance& instance) {
+    assert(mInstanceCount < MaximumInstanceCount);
+    mInstanceCount++;
+
+    Texture& texture = instance.getTexture();
+    mTextureManager->use(texture);
+    GeometryRecord* geometry = acquireGeometry(instance.getMesh());
+
+    /* The instances of a geometry are kept grouped by texture, each group is one draw */
+    InstanceData data{&instance, acquireTextureSlot(texture)};
+    auto position = std::upper_bound(geometry->instances.begin(), geometry->instances.end(), data,
+        [](const InstanceData& a, const InstanceData& b) { return a.textureIndex < b.textureIndex; });
+    geometry->instances.insert(position, data);
+}
+
+void MeshManager::removeInstance(MeshInstance& instance) {
+    auto bindingIt = mRenderData.geometryBindings.find(&instance.getMesh());
+    assert(bindingIt != mRenderData.geometryBindings.end());
+
+    std::vector<InstanceData>& instances = bindingIt->second.geometry->instances;
+    auto instanceIt = std::find_if(instances.begin(), instances.end(),
+                                   [&instance](const InstanceData& data) { return data.instance == &instance; });
+    assert(instanceIt != instances.end());
+    releaseTextureSlot(instanceIt->textureIndex);
+    instances.erase(instanceIt);
+    mInstanceCount--;
+
+    releaseGeometry(instance.getMesh());
 }
 
 void MeshManager::setImageCount(uint32_t count) {
-    mRenderData.renderBuffers.resize(count);
-    mTransferCompleteFences.resize(count);
-    mTemporaryStaticBuffers.resize(count);
-    mShouldSwapBuffers.resize(count, true);
-    mFirstTransfer.resize(count, true);
+    /* Also called when the swap chain is recreated with another image count, once the device is idle */
+    for (size_t i{0};i < mEvents.size();++i) {
+        vkDestroyEvent(mContext->getDevice(), mEvents[i], nullptr);
+    }
     mEvents.resize(count);
 
-    VkFenceCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-
-    VkEventCreateInfo createInfo2{};
-    createInfo2.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO;
+    VkEventCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO;
 
     for (size_t i{0};i < count;++i) {
-        if (vkCreateFence(mContext->getDevice(), &createInfo, nullptr, &mTransferCompleteFences[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Error, failed to create fence");
+        if (vkCreateEvent(mContext->getDevice(), &createInfo, nullptr, &mEvents[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Error, failed to create event");
         }
+    }
 
-        if (vkCreateEvent(mContext->getDevice(), &createInfo2, nullptr, &mEvents[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Error, failed to create event");
+    if (mIndirectDraw) {
+        /* The descriptor pool can't free sets, the ones already allocated are kept for the first images */
+        size_t allocatedCount = mRenderData.indirectDescriptorSets.size();
+        if (count > allocatedCount) {
+            std::vector<VkDescriptorSetLayout> layouts(count - allocatedCount, mRenderData.indirectDescriptorSetLayout);
+
+            VkDescriptorSetAllocateInfo infos{};
+            infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            infos.descriptorPool = mContext->getDescriptorPool().getHandler();
+            infos.descriptorSetCount = count - allocatedCount;
+            infos.pSetLayouts = layouts.data();
+
+            mRenderData.indirectDescriptorSets.resize(count);
+            if (vkAllocateDescriptorSets(mContext->getDevice(), &infos, mRenderData.indirectDescriptorSets.data() + allocatedCount) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate descriptor sets");
+            }
+        }
+
+        /* The frame allocator has been created again, every set is written before its next use */
+        mRenderData.indirectDescriptorVersions.assign(mRenderData.indirectDescriptorSets.size(), 0);
+    } else {
+        for (auto& binding : mRenderData.meshDataBinding) {
+            updateDescriptorSet(*binding.first, *binding.second);
+        }
+        for (TextureSlot& slot : mTextureSlots) {
+            if (slot.texture != nullptr) {
+                writeDescriptorSet(slot.descriptorSet, *slot.texture);
+            }
         }
     }
 }
 
-void MeshManager::update(uint32_t imageIndex) {
-    if (mNeedStagingUpdate) {
-        updateStagingBuffers();
+VkSemaphore MeshManager::update(uint32_t imageIndex) {
+    updateTextureSlots();
+    for (auto& binding : mRenderData.meshDataBinding) {
+        if (binding.second->textureVersion != binding.first->getTexture().getVersion()) {
+            updateDescriptorSet(*binding.first, *binding.second);
+        }
     }
 
-    if (mRenderData.renderBuffers[imageIndex].needUpdate) {
-        updateStaticBuffers(imageIndex);
+    completeTransfer();
+    bool submitted = submitTransfer();
+    if (mIndirectDraw) {
+        updateIndirectDescriptorSet(imageIndex);
+        updateDrawBuffers();
+    } else {
+        updateModelMatrices();
     }
 
-    updateUniformBuffer();
+    /* The frame reading the new geometry waits for its copy, the next ones are ordered after this frame */
+    return submitted ? mTransferCompleteSemaphore : VK_NULL_HANDLE;
 }
 
 VkCommandBuffer MeshManager::render(const VkRenderPass renderPass, const VkFramebuffer frameBuffer, const VkCommandPool commandPool,
-                         const VkDescriptorSet cameraDescriptorSet, const VkPipelineLayout pipelineLayout, const VkPipeline pipeline,
+                         const VkDescriptorSet cameraDescriptorSet, uint32_t cameraDynamicOffset,
+                         const VkPipelineLayout pipelineLayout, const VkPipeline pipeline,
                          uint32_t imageIndex) {
-    if (mShouldSwapBuffers[imageIndex]) {
-        if (mFirstTransfer[imageIndex]) {
-            vkWaitForFences(mContext->getDevice(), 1, &mTransferCompleteFences[imageIndex], VK_TRUE, 1000000000);
-            mFirstTransfer[imageIndex] = false;
-
-            mRenderData.renderBuffers[imageIndex] = mTemporaryStaticBuffers[imageIndex];
-            mShouldSwapBuffers[imageIndex] = false;
-
-            while (!mTemporaryMeshes.empty()) {
-                mMeshes.push_back(mTemporaryMeshes.back());
-                mTemporaryMeshes.pop_back();
-            }
-
-            vkResetFences(mContext->getDevice(), 1, &mTransferCompleteFences[imageIndex]);
-        } else {
-            if (vkGetFenceStatus(mContext->getDevice(), mTransferCompleteFences[imageIndex]) == VK_SUCCESS) {
-                mRenderData.renderBuffers[imageIndex] = mTemporaryStaticBuffers[imageIndex];
-                mShouldSwapBuffers[imageIndex] = false;
-
-
-                while (!mTemporaryMeshes.empty()) {
-                    mMeshes.push_back(mTemporaryMeshes.back());
-                    mTemporaryMeshes.pop_back();
-                }
-
-                vkResetFences(mContext->getDevice(), 1, &mTransferCompleteFences[imageIndex]);
-            }
-        }
-    }
     VkCommandBufferAllocateInfo allocateInfo{};
     allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocateInfo.commandPool = commandPool;
@@ -161,20 +237,19 @@ VkCommandBuffer MeshManager::render(const VkRenderPass renderPass, const VkFrame
                             VK_PIPELINE_BIND_POINT_GRAPHICS,
                             pipelineLayout,
                             1, 1, &cameraDescriptorSet,
-                            0, nullptr);
+                            1, &cameraDynamicOffset);
 
 
-    uint32_t offset{0};
-    VkDeviceSize vertexOffset{0};
-    vkCmdBindVertexBuffers(staticCommandBuffer, 0, 1, &mRenderData.renderBuffers[imageIndex].vertexBuffer, &vertexOffset);
-    vkCmdBindIndexBuffer(staticCommandBuffer, mRenderData.renderBuffers[imageIndex].indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    GeometryBuffers& geometryBuffers = mRenderData.geometryBuffers;
+    if (geometryBuffers.vertexCapacity != 0 && geometryBuffers.indexCapacity != 0) {
+        vkCmdBindVertexBuffers(staticCommandBuffer, 0, 1, &geometryBuffers.vertexBuffer.buffer, &geometryBuffers.vertexBuffer.offset);
+        vkCmdBindIndexBuffer(staticCommandBuffer, geometryBuffers.indexBuffer.buffer, geometryBuffers.indexBuffer.offset, VK_INDEX_TYPE_UINT32);
 
-    for (Mesh* mesh : mMeshes) {
-        vkCmdBindDescriptorSets(staticCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout, 0, 1, &mRenderData.meshDataBinding[mesh]->descriptorSet,
-            0, nullptr);
-        vkCmdDrawIndexed(staticCommandBuffer, mesh->getIndices().size(), 1, offset, 0, 0);
-        offset += mesh->getIndices().size();
+        if (mIndirectDraw) {
+            recordIndirectDraws(staticCommandBuffer, pipelineLayout, imageIndex);
+        } else {
+            recordDraws(staticCommandBuffer, pipelineLayout);
+        }
     }
 
     vkEndCommandBuffer(staticCommandBuffer);
@@ -183,34 +258,179 @@ VkCommandBuffer MeshManager::render(const VkRenderPass renderPass, const VkFrame
 }
 
 VkDescriptorSetLayout MeshManager::getDescriptorSetLayout() const {
-    return mRenderData.descriptorSetLayout;
+    return mIndirectDraw ? mRenderData.indirectDescriptorSetLayout : mRenderData.descriptorSetLayout;
+}
+
+bool MeshManager::isIndirectDrawEnabled() const {
+    return mIndirectDraw;
+}
+
+VkDeviceSize MeshManager::getFrameDataSize() const {
+    /* What update writes in the frame allocator at most, every frame */
+    if (mIndirectDraw) {
+        return (sizeof(DrawData) + sizeof(VkDrawIndexedIndirectCommand)) * MaximumDrawDataCount;
+    }
+    return sizeof(glm::mat4) * MaximumDrawDataCount;
 }
 
-void MeshManager::updateUniformBuffer() {
-    void* mappingBegin;
-    mContext->getMemoryManager().mapMemory(mRenderData.modelTransformBuffer,
-        mRenderData.modelTransformBufferSize, &mappingBegin);
+void MeshManager::recordDraws(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) {
+    if (mMeshes.empty() && mInstanceCount == 0) {
+        return;
+    }
+
+    /* The meshes keep their own indices, the ranges give the first index and the vertex offset */
+    uint32_t modelMatricesOffset = static_cast<uint32_t>(mRenderData.modelMatrices.offset);
     for (Mesh* mesh : mMeshes) {
-        glm::mat4 m = mesh->getTransform().getMatrix();
-        void* ptr = (uint8_t*)mappingBegin + mRenderData.meshDataBinding[mesh]->uniformBufferDynamicOffset;
-        memcpy(ptr, &m, sizeof(glm::mat4));
+        MeshData* meshData = mRenderData.meshDataBinding[mesh];
+        GeometryRecord& geometry = *meshData->geometry;
+        if (!geometry.resident || geometry.indexRange.count == 0) {
+            continue;
+        }
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout, 0, 1, &meshData->descriptorSet,
+            1, &modelMatricesOffset);
+        vkCmdDrawIndexed(commandBuffer, geometry.indexRange.count, 1, geometry.indexRange.offset,
+                         geometry.vertexRange.offset, meshData->modelIndex);
+    }
+
+    /* One instanced draw per geometry and texture, the first instance is the index of its first model matrix */
+    for (auto& entry : mRenderData.geometries) {
+        GeometryRecord& geometry = entry.second;
+        if (!geometry.resident || geometry.indexRange.count == 0) {
+            continue;
+        }
+        for (size_t i{0};i < geometry.instances.size();) {
+            const InstanceData& first = geometry.instances[i];
+            uint32_t instanceCount{0};
+            for (;i < geometry.instances.size() && geometry.instances[i].textureIndex == first.textureIndex;++i) {
+                instanceCount++;
+            }
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                pipelineLayout, 0, 1, &mTextureSlots[first.textureIndex].descriptorSet,
+                1, &modelMatricesOffset);
+            vkCmdDrawIndexed(commandBuffer, geometry.indexRange.count, instanceCount, geometry.indexRange.offset,
+                             geometry.vertexRange.offset, first.modelIndex);
+        }
     }
-    mContext->getMemoryManager().unmapMemory(mRenderData.modelTransformBuffer);
 }
 
-void MeshManager::createDescriptorSetLayout() {
-    /* Create the descriptor set layout */
+void MeshManager::recordIndirectDraws(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t imageIndex) {
+    if (mRenderData.drawCount == 0) {
+        return;
+    }
+
+    /* The whole scene in one call, whatever its mesh count */
+    uint32_t drawDataOffset = static_cast<uint32_t>(mRenderData.drawData.offset);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout, 0, 1, &mRenderData.indirectDescriptorSets[imageIndex],
+        1, &drawDataOffset);
+    vkCmdDrawIndexedIndirect(commandBuffer, mRenderData.drawCommands.buffer, mRenderData.drawCommands.offset,
+                             mRenderData.drawCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void MeshManager::updateModelMatrices() {
+    if (mMeshes.empty() && mInstanceCount == 0) {
+        return;
+    }
+
+    /**
+     * The model matrices only live for this frame, they are written in the
+     * frame allocator. The descriptor range covers the maximum count, and the
+     * instances of a group are consecutive so that they are drawn at once.
+     */
+    mRenderData.modelMatrices = mContext->getMemoryManager().getFrameAllocator().allocate(
+        sizeof(glm::mat4) * MaximumDrawDataCount);
+    glm::mat4* models = static_cast<glm::mat4*>(mRenderData.modelMatrices.data);
+    uint32_t modelCount{0};
+    for (Mesh* mesh : mMeshes) {
+        models[modelCount] = mesh->getTransform().getMatrix();
+        mRenderData.meshDataBinding[mesh]->modelIndex = modelCount++;
+    }
+
+    for (auto& entry : mRenderData.geometries) {
+        for (InstanceData& instance : entry.second.instances) {
+            models[modelCount] = instance.instance->getTransform().getMatrix();
+            instance.modelIndex = modelCount++;
+        }
+    }
+}
+
+void MeshManager::updateDrawBuffers() {
+    mRenderData.drawCount = 0;
+    if (mMeshes.empty() && mInstanceCount == 0) {
+        return;
+    }
+
+    /* The descriptor range covers the maximum draw data count, the commands only the draws */
+    FrameAllocator& frameAllocator = mContext->getMemoryManager().getFrameAllocator();
+    mRenderData.drawData = frameAllocator.allocate(sizeof(DrawData) * MaximumDrawDataCount);
+    mRenderData.drawCommands = frameAllocator.allocate(sizeof(VkDrawIndexedIndirectCommand) *
+                                                       (mMeshes.size() + mInstanceCount));
+
+    DrawData* draws = static_cast<DrawData*>(mRenderData.drawData.data);
+    VkDrawIndexedIndirectCommand* commands = static_cast<VkDrawIndexedIndirectCommand*>(mRenderData.drawCommands.data);
+    uint32_t drawDataCount{0};
+    for (Mesh* mesh : mMeshes) {
+        MeshData* meshData = mRenderData.meshDataBinding[mesh];
+        GeometryRecord& geometry = *meshData->geometry;
+        if (!geometry.resident || geometry.indexRange.count == 0) {
+            continue;
+        }
+
+        draws[drawDataCount].model = mesh->getTransform().getMatrix();
+        draws[drawDataCount].textureIndex = meshData->textureIndex;
+
+        /* The first instance is the index of the draw data, the shaders read it with the instance index */
+        VkDrawIndexedIndirectCommand& command = commands[mRenderData.drawCount++];
+        command.indexCount = geometry.indexRange.count;
+        command.instanceCount = 1;
+        command.firstIndex = geometry.indexRange.offset;
+        command.vertexOffset = static_cast<int32_t>(geometry.vertexRange.offset);
+        command.firstInstance = drawDataCount++;
+    }
+
+    /**
+     * One draw per geometry and texture, its instances have consecutive draw
+     * data. The texture index must be the same across a draw, the fragment
+     * shader indexes the texture array without nonuniform indexing.
+     */
+    for (auto& entry : mRenderData.geometries) {
+        GeometryRecord& geometry = entry.second;
+        if (geometry.instances.empty() || !geometry.resident || geometry.indexRange.count == 0) {
+            continue;
+        }
+
+        for (size_t i{0};i < geometry.instances.size();) {
+            VkDrawIndexedIndirectCommand& command = commands[mRenderData.drawCount++];
+            command.indexCount = geometry.indexRange.count;
+            command.instanceCount = 0;
+            command.firstIndex = geometry.indexRange.offset;
+            command.vertexOffset = static_cast<int32_t>(geometry.vertexRange.offset);
+            command.firstInstance = drawDataCount;
+
+            uint32_t textureIndex = geometry.instances[i].textureIndex;
+            for (;i < geometry.instances.size() && geometry.instances[i].textureIndex == textureIndex;++i) {
+                draws[drawDataCount].model = geometry.instances[i].instance->getTransform().getMatrix();
+                draws[drawDataCount].textureIndex = textureIndex;
+                drawDataCount++;
+                command.instanceCount++;
+            }
+        }
+    }
+}
+
+void MeshManager::createIndirectDescriptorSetLayout() {
     VkDescriptorSetLayoutBinding bindings[2] = {};
 
-    /* Texture binding */
+    /* Textures of every mesh, indexed by the draw data */
     bindings[0].binding = 0;
     bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[0].descriptorCount = 1;
+    bindings[0].descriptorCount = MaximumTextureCount;
     bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    /* Model matrix binding */
+    /* Draw data binding */
     bindings[1].binding = 1;
-    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
     bindings[1].descriptorCount = 1;
     bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -219,194 +439,265 @@ void MeshManager::createDescriptorSetLayout() {
     createInfo.bindingCount = 2;
     createInfo.pBindings = bindings;
 
-    if (vkCreateDescriptorSetLayout(mContext->getDevice(), &createInfo, nullptr, &mRenderData.descriptorSetLayout) != VK_SUCCESS) {
+    if (vkCreateDescriptorSetLayout(mContext->getDevice(), &createInfo, nullptr, &mRenderData.indirectDescriptorSetLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor set layout");
     }
 }
 
-void MeshManager::allocateUniformBuffer() {
-    uint32_t size;
-
-    /* Handle the case when the render data size is less than the minimum offset alignment */
-    if (sizeof(glm::mat4) > mContext->getLimits().minUniformBufferOffsetAlignment)
-        size = sizeof(glm::mat4) * MaximumMeshCount;
-    else
-        size = mContext->getLimits().minUniformBufferOffsetAlignment * MaximumMeshCount;
+void MeshManager::updateIndirectDescriptorSet(uint32_t imageIndex) {
+    /* The fence of this image has been waited for, its set isn't used anymore */
+    if (mRenderData.indirectDescriptorVersions[imageIndex] == mTextureSlotsVersion) {
+        return;
+    }
 
-    BufferHelper::createBuffer(*mContext, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                               VK_SHARING_MODE_EXCLUSIVE,
-                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                               mRenderData.modelTransformBuffer, "MeshManager::modelTransformBuffer");
-    mRenderData.modelTransformBufferSize = size;
-}
+    /* The shader may index the whole array, so the free slots repeat a texture in use */
+    auto usedSlot = std::find_if(mTextureSlots.begin(), mTextureSlots.end(),
+                                 [](const TextureSlot& slot) { return slot.texture != nullptr; });
+    if (usedSlot == mTextureSlots.end()) {
+        return;
+    }
 
-void MeshManager::allocateDescriptorSets() {
-    std::vector<VkDescriptorSetLayout> layouts(MaximumMeshCount, mRenderData.descriptorSetLayout);
+    std::array<VkDescriptorImageInfo, MaximumTextureCount> infos{};
+    for (size_t i{0};i < MaximumTextureCount;++i) {
+        Texture& texture = mTextureSlots[i].texture != nullptr ? *mTextureSlots[i].texture : *usedSlot->texture;
+        infos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        infos[i].imageView = texture.getImageView().getHandler();
+        infos[i].sampler = texture.getSampler().getHandler();
+    }
 
-    VkDescriptorSetAllocateInfo infos{};
-    infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    infos.descriptorPool = mContext->getDescriptorPool().getHandler();
-    infos.descriptorSetCount = MaximumMeshCount;
-    infos.pSetLayouts = layouts.data();
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = mContext->getMemoryManager().getFrameAllocator().getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(DrawData) * MaximumDrawDataCount;
 
-    std::vector<VkDescriptorSet> descriptors(MaximumMeshCount, VK_NULL_HANDLE);
+    VkWriteDescriptorSet writes[2] = {};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].descriptorCount = MaximumTextureCount;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].dstBinding = 0;
+    writes[0].dstSet = mRenderData.indirectDescriptorSets[imageIndex];
+    writes[0].pImageInfo = infos.data();
 
-    if (vkAllocateDescriptorSets(mContext->getDevice(), &infos, descriptors.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate descriptor sets");
-    }  
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    writes[1].dstBinding = 1;
+    writes[1].dstSet = mRenderData.indirectDescriptorSets[imageIndex];
+    writes[1].pBufferInfo = &bufferInfo;
 
-    /* Copy to the mesh data pool */
-    uint32_t size = sizeof(glm::mat4) < mContext->getLimits().minUniformBufferOffsetAlignment ?
-        mContext->getLimits().minUniformBufferOffsetAlignment :
-        sizeof(glm::mat4);
+    vkUpdateDescriptorSets(mContext->getDevice(), 2, writes, 0, nullptr);
+    mRenderData.indirectDescriptorVersions[imageIndex] = mTextureSlotsVersion;
+}
 
-    for (size_t i{0};i < MaximumMeshCount;++i) {
-        mRenderData.meshDataPool[i].descriptorSet = descriptors[i];
-        mRenderData.meshDataPool[i].uniformBufferDynamicOffset = i * size;
+uint32_t MeshManager::acquireTextureSlot(Texture& texture) {
+    auto slotIt = std::find_if(mTextureSlots.begin(), mTextureSlots.end(),
+                               [&texture](const TextureSlot& slot) { return slot.texture == &texture; });
+    if (slotIt == mTextureSlots.end()) {
+        slotIt = std::find_if(mTextureSlots.begin(), mTextureSlots.end(),
+                              [](const TextureSlot& slot) { return slot.texture == nullptr; });
+        if (slotIt == mTextureSlots.end()) {
+            throw std::runtime_error("Too many textures used by the meshes");
+        }
+        slotIt->texture = &texture;
+        slotIt->textureVersion = texture.getVersion();
+        if (!mIndirectDraw) {
+            writeDescriptorSet(slotIt->descriptorSet, texture);
+        }
+        mTextureSlotsVersion++;
     }
+
+    slotIt->useCount++;
+    return static_cast<uint32_t>(slotIt - mTextureSlots.begin());
 }
 
-void MeshManager::updateStagingBuffers() {
-    /* Compute buffer sizes */
-    uint32_t vertexBufferSize{0}, vertexBufferSizeInBytes{0};
-    uint32_t indexBufferSize{0}, indexBufferSizeInBytes{0};
-    for (Mesh* mesh : mMeshes) {
-        vertexBufferSize += mesh->getVertices().size();
-        indexBufferSize += mesh->getIndices().size();
+void MeshManager::releaseTextureSlot(uint32_t index) {
+    if (--mTextureSlots[index].useCount > 0) {
+        return;
     }
 
-    for (Mesh* mesh : mTemporaryMeshes) {
-        vertexBufferSize += mesh->getVertices().size();
-        indexBufferSize += mesh->getIndices().size();
-    }
-    vertexBufferSizeInBytes = vertexBufferSize * sizeof(Vertex);
-    indexBufferSizeInBytes = indexBufferSize * sizeof(uint32_t);
+    /* The frames in flight may still sample the texture through the slot, unless it has been used again since */
+    mContext->getMemoryManager().releaseDeferred([this, index]() {
+        TextureSlot& slot = mTextureSlots[index];
+        if (slot.useCount == 0 && slot.texture != nullptr) {
+            slot.texture = nullptr;
+            mTextureSlotsVersion++;
+        }
+    });
+}
 
-    /* If the buffer were already allocated, free them */
-    if (mRenderData.stagingBuffers.vertexBufferSizeInBytes != 0)
-        mContext->getMemoryManager().freeBuffer(mRenderData.stagingBuffers.vertexBuffer);
-    if (mRenderData.stagingBuffers.indexBufferSizeInBytes != 0)
-        mContext->getMemoryManager().freeBuffer(mRenderData.stagingBuffers.indexBuffer);
-    
-    /* Allocate the device local buffers */
-    BufferHelper::createBuffer(
-        *mContext, vertexBufferSizeInBytes,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_SHARING_MODE_EXCLUSIVE,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        mRenderData.stagingBuffers.vertexBuffer,
-        "MeshRenderer::stagingVertexBuffer");
-    BufferHelper::createBuffer(
-        *mContext, indexBufferSizeInBytes,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_SHARING_MODE_EXCLUSIVE,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        mRenderData.stagingBuffers.indexBuffer,
-        "MeshRenderer::stagingIndexBuffer");
-    
-    /* Compute the local buffers */
-    std::vector<Vertex> localVertexBuffer(vertexBufferSize);
-    std::vector<uint32_t> localIndexBuffer(indexBufferSize);
+void MeshManager::updateTextureSlots() {
+    /* Keep the textures resident, one uploaded again was idle for long enough to rewrite its descriptors */
+    for (TextureSlot& slot : mTextureSlots) {
+        if (slot.useCount == 0) {
+            continue;
+        }
 
-    auto vertexIterator = localVertexBuffer.begin();
-    auto indexIterator = localIndexBuffer.begin();
-    uint32_t indexOffset{0};
-    for (Mesh* mesh : mMeshes) {
-        vertexIterator = std::copy(mesh->getVertices().begin(), mesh->getVertices().end(),
-                                   vertexIterator);
+        mTextureManager->use(*slot.texture);
+        if (slot.textureVersion != slot.texture->getVersion()) {
+            slot.textureVersion = slot.texture->getVersion();
+            if (!mIndirectDraw) {
+                writeDescriptorSet(slot.descriptorSet, *slot.texture);
+            }
+            mTextureSlotsVersion++;
+        }
+    }
+}
 
-        indexIterator = std::transform(
-            mesh->getIndices().begin(), mesh->getIndices().end(),
-            indexIterator, [indexOffset](const uint32_t& i) { return i + indexOffset; });
-        indexOffset += mesh->getVertices().size();
+GeometryRecord* MeshManager::acquireGeometry(Mesh& mesh) {
+    GeometryBinding& binding = mRenderData.geometryBindings[&mesh];
+    if (binding.useCount++ > 0) {
+        return binding.geometry;
     }
 
-    for (Mesh* mesh : mTemporaryMeshes) {
-        vertexIterator = std::copy(mesh->getVertices().begin(), mesh->getVertices().end(),
-                                   vertexIterator);
+    /* Meshes imported or generated separately often have the same content, it is only copied once */
+    const std::vector<Vertex>& vertices = mesh.getVertices();
+    const std::vector<uint32_t>& indices = mesh.getIndices();
+    uint64_t hash = Hash::xxHash64(vertices.data(), vertices.size() * sizeof(Vertex));
+    hash = Hash::xxHash64(indices.data(), indices.size() * sizeof(uint32_t), hash);
+    binding.geometry = findGeometry(mesh, hash);
+    if (binding.geometry != nullptr) {
+        binding.geometry->useCount++;
+        return binding.geometry;
+    }
 
-        indexIterator = std::transform(
-            mesh->getIndices().begin(), mesh->getIndices().end(),
-            indexIterator, [indexOffset](const uint32_t& i) { return i + indexOffset; });
-        indexOffset += mesh->getVertices().size();
+    GeometryRecord& geometry = mRenderData.geometries.emplace(hash, GeometryRecord{})->second;
+    binding.geometry = &geometry;
+    geometry.useCount = 1;
+    geometry.hash = hash;
+    geometry.source = &mesh;
+
+    /* Only this geometry is written, in free ranges of the arenas, the other ones stay where they are */
+    geometry.vertexRange = mVertexArena.allocate(vertices.size());
+    geometry.indexRange = mIndexArena.allocate(indices.size());
+    geometry.resident = vertices.empty() && indices.empty();
+    if (geometry.resident) {
+        return &geometry;
     }
 
-    /* Copy the buffers */
-    void* data;
-    mContext->getMemoryManager().mapMemory(mRenderData.stagingBuffers.vertexBuffer, vertexBufferSizeInBytes, &data);
-    memcpy(data, localVertexBuffer.data(), vertexBufferSizeInBytes);
-    mContext->getMemoryManager().unmapMemory(mRenderData.stagingBuffers.vertexBuffer);
+    size_t verticesSize = vertices.size() * sizeof(Vertex);
+    GeometryUpload upload{&geometry};
+    upload.staging = mContext->getMemoryManager().getBufferPool(BufferClass::Staging).allocate(
+        verticesSize + indices.size() * sizeof(uint32_t));
+    memcpy(upload.staging.data, vertices.data(), verticesSize);
+    memcpy(static_cast<uint8_t*>(upload.staging.data) + verticesSize, indices.data(), indices.size() * sizeof(uint32_t));
+    upload.vertexRange = geometry.vertexRange;
+    upload.indexRange = geometry.indexRange;
+    mUploads.push_back(upload);
+    return &geometry;
+}
+
+GeometryRecord* MeshManager::findGeometry(const Mesh& mesh, uint64_t hash) {
+    /* The hash only selects the candidates, the bytes decide as they are what is copied */
+    const std::vector<Vertex>& vertices = mesh.getVertices();
+    const std::vector<uint32_t>& indices = mesh.getIndices();
+    auto candidates = mRenderData.geometries.equal_range(hash);
+    for (auto it = candidates.first;it != candidates.second;++it) {
+        const Mesh& source = *it->second.source;
+        if (source.getVertices().size() == vertices.size() && source.getIndices().size() == indices.size() &&
+            memcmp(vertices.data(), source.getVertices().data(), vertices.size() * sizeof(Vertex)) == 0 &&
+            memcmp(indices.data(), source.getIndices().data(), indices.size() * sizeof(uint32_t)) == 0) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
 
-    mContext->getMemoryManager().mapMemory(mRenderData.stagingBuffers.indexBuffer, indexBufferSizeInBytes, &data);
-    memcpy(data, localIndexBuffer.data(), indexBufferSizeInBytes);
-    mContext->getMemoryManager().unmapMemory(mRenderData.stagingBuffers.indexBuffer);
+void MeshManager::releaseGeometry(const Mesh& mesh) {
+    auto bindingIt = mRenderData.geometryBindings.find(&mesh);
+    assert(bindingIt != mRenderData.geometryBindings.end());
+    GeometryRecord& geometry = *bindingIt->second.geometry;
+    if (--bindingIt->second.useCount > 0) {
+        return;
+    }
+    mRenderData.geometryBindings.erase(bindingIt);
+
+    /* The content is compared with the source, another mesh bound to the geometry takes over */
+    if (--geometry.useCount > 0) {
+        if (geometry.source == &mesh) {
+            auto sourceIt = std::find_if(mRenderData.geometryBindings.begin(), mRenderData.geometryBindings.end(),
+                [&geometry](const std::pair<const Mesh* const, GeometryBinding>& entry) { return entry.second.geometry == &geometry; });
+            geometry.source = sourceIt->first;
+        }
+        return;
+    }
 
-    mRenderData.stagingBuffers.vertexBufferSize = vertexBufferSize;
-    mRenderData.stagingBuffers.vertexBufferSizeInBytes = vertexBufferSizeInBytes;
-    mRenderData.stagingBuffers.indexBufferSize = indexBufferSize;
-    mRenderData.stagingBuffers.indexBufferSizeInBytes = indexBufferSizeInBytes;
+    /* The frames in flight may still draw the geometry, its ranges are reused once they complete */
+    GeometryRange vertexRange = geometry.vertexRange;
+    GeometryRange indexRange = geometry.indexRange;
+    mContext->getMemoryManager().releaseDeferred([this, vertexRange, indexRange]() {
+        mVertexArena.free(vertexRange);
+        mIndexArena.free(indexRange);
+    });
+
+    /* A copy that hasn't been submitted yet is dropped, a submitted one keeps its staging until it completes */
+    for (size_t i{0};i < mUploads.size();++i) {
+        GeometryUpload& upload = mUploads[i];
+        if (upload.geometry != &geometry) {
+            continue;
+        }
 
-    for (auto& buffers : mRenderData.renderBuffers) {
-        buffers.needUpdate = true;
+        upload.geometry = nullptr;
+        if (!upload.submitted) {
+            mContext->getMemoryManager().getBufferPool(BufferClass::Staging).free(upload.staging);
+            upload = mUploads.back();
+            mUploads.pop_back();
+        }
+        break;
     }
 
-    mNeedStagingUpdate = false;
+    auto candidates = mRenderData.geometries.equal_range(geometry.hash);
+    auto geometryIt = std::find_if(candidates.first, candidates.second,
+        [&geometry](const std::pair<const uint64_t, GeometryRecord>& entry) { return &entry.second == &geometry; });
+    mRenderData.geometries.erase(geometryIt);
 }
 
-void MeshManager::updateDescriptorSet(Mesh& mesh, MeshData& meshData) {
-    /* Texture info */
-    VkDescriptorImageInfo info{};
-    info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    info.imageView = mesh.getTexture().getImageView().getHandler();
-    info.sampler = mesh.getTexture().getSampler().getHandler();
-
-    /* Uniform buffer info */
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = mRenderData.modelTransformBuffer;
-    bufferInfo.offset = meshData.uniformBufferDynamicOffset;
-    bufferInfo.range = sizeof(glm::mat4);
+void MeshManager::createTransferSynchronization() {
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(mContext->getDevice(), &fenceInfo, nullptr, &mTransferCompleteFence) != VK_SUCCESS) {
+        throw std::runtime_error("Error, failed to create fence");
+    }
 
-    VkWriteDescriptorSet writes[2] = {};
-    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[0].descriptorCount = 1;
-    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    writes[0].dstBinding = 0;
-    writes[0].dstSet = meshData.descriptorSet;
-    writes[0].pImageInfo = &info;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (vkCreateSemaphore(mContext->getDevice(), &semaphoreInfo, nullptr, &mTransferCompleteSemaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Error, failed to create semaphore");
+    }
+}
 
-    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[1].descriptorCount = 1;
-    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    writes[1].dstBinding = 1;
-    writes[1].dstSet = meshData.descriptorSet;
-    writes[1].pBufferInfo = &bufferInfo;
+void MeshManager::completeTransfer() {
+    if (mTransferCommandBuffer == VK_NULL_HANDLE ||
+        vkGetFenceStatus(mContext->getDevice(), mTransferCompleteFence) != VK_SUCCESS) {
+        return;
+    }
 
-    vkUpdateDescriptorSets(mContext->getDevice(), 2, writes, 0, nullptr);
+    vkResetFences(mContext->getDevice(), 1, &mTransferCompleteFence);
+    vkFreeCommandBuffers(mContext->getDevice(), mContext->getTransferCommandPool().getHandler(),
+                         1, &mTransferCommandBuffer);
+    mTransferCommandBuffer = VK_NULL_HANDLE;
+
+    BufferPool& stagingPool = mContext->getMemoryManager().getBufferPool(BufferClass::Staging);
+    for (size_t i{0};i < mUploads.size();) {
+        if (mUploads[i].submitted) {
+            stagingPool.free(mUploads[i].staging);
+            mUploads[i] = mUploads.back();
+            mUploads.pop_back();
+        } else {
+            ++i;
+        }
+    }
 }
 
-void MeshManager::updateStaticBuffers(uint32_t imageIndex) {
-    RenderBuffers renderBuffer;
-    renderBuffer.vertexBufferSize = mRenderData.stagingBuffers.vertexBufferSize;
-    renderBuffer.vertexBufferSizeInBytes = mRenderData.stagingBuffers.vertexBufferSizeInBytes;
-    renderBuffer.indexBufferSize = mRenderData.stagingBuffers.indexBufferSize;
-    renderBuffer.indexBufferSizeInBytes = mRenderData.stagingBuffers.indexBufferSizeInBytes;
-    renderBuffer.needUpdate = false;
-    BufferHelper::createBuffer(
-        *mContext, mRenderData.stagingBuffers.vertexBufferSizeInBytes,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_SHARING_MODE_EXCLUSIVE,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        renderBuffer.vertexBuffer,
-        "MeshRenderer::vertexBuffer");
-    BufferHelper::createBuffer(
-        *mContext, mRenderData.stagingBuffers.indexBufferSizeInBytes,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_SHARING_MODE_EXCLUSIVE,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        renderBuffer.indexBuffer,
-        "MeshRenderer::indexBuffer");
-
-    VkCommandBuffer transferCommandBuffer;
+bool MeshManager::submitTransfer() {
+    /**
+     * One transfer at a time: a growth copies the whole buffer, which must
+     * already hold the previous copies. The uploads wait for the next frame.
+     */
+    GeometryBuffers& buffers = mRenderData.geometryBuffers;
+    bool mustGrow = buffers.vertexCapacity < mVertexArena.getCapacity() || buffers.indexCapacity < mIndexArena.getCapacity();
+    if (mTransferCommandBuffer != VK_NULL_HANDLE || (mUploads.empty() && !mustGrow)) {
+        return false;
+    }
 
     VkCommandBufferAllocateInfo allocateInfo{};
     allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -414,7 +705,7 @@ void MeshManager::updateStaticBuffers(uint32_t imageIndex) {
     allocateInfo.commandBufferCount = 1;
     allocateInfo.commandPool = mContext->getTransferCommandPool().getHandler();
 
-    if (vkAllocateCommandBuffers(mContext->getDevice(), &allocateInfo, &transferCommandBuffer) != VK_SUCCESS) {
+    if (vkAllocateCommandBuffers(mContext->getDevice(), &allocateInfo, &mTransferCommandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate command buffer");
     }
 
@@ -422,26 +713,174 @@ void MeshManager::updateStaticBuffers(uint32_t imageIndex) {
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    VkBufferCopy region{};
-    region.size = mRenderData.stagingBuffers.vertexBufferSizeInBytes;    
+    vkBeginCommandBuffer(mTransferCommandBuffer, &beginInfo);
+    if (mustGrow) {
+        growGeometryBuffers(mTransferCommandBuffer);
+    }
+
+    for (GeometryUpload& upload : mUploads) {
+        VkBufferCopy region{};
+        region.srcOffset = upload.staging.offset;
+        region.dstOffset = buffers.vertexBuffer.offset + upload.vertexRange.offset * sizeof(Vertex);
+        region.size = upload.vertexRange.count * sizeof(Vertex);
+        if (region.size != 0) {
+            vkCmdCopyBuffer(mTransferCommandBuffer, upload.staging.buffer, buffers.vertexBuffer.buffer, 1, &region);
+        }
 
-    vkBeginCommandBuffer(transferCommandBuffer, &beginInfo);
-    vkCmdCopyBuffer(transferCommandBuffer, mRenderData.stagingBuffers.vertexBuffer, renderBuffer.vertexBuffer,
-                    1, &region);
-    region.size = mRenderData.stagingBuffers.indexBufferSizeInBytes;
-    vkCmdCopyBuffer(transferCommandBuffer, mRenderData.stagingBuffers.indexBuffer, renderBuffer.indexBuffer,
-                    1, &region);
-    vkEndCommandBuffer(transferCommandBuffer);
+        region.srcOffset += region.size;
+        region.dstOffset = buffers.indexBuffer.offset + upload.indexRange.offset * sizeof(uint32_t);
+        region.size = upload.indexRange.count * sizeof(uint32_t);
+        if (region.size != 0) {
+            vkCmdCopyBuffer(mTransferCommandBuffer, upload.staging.buffer, buffers.indexBuffer.buffer, 1, &region);
+        }
+
+        upload.submitted = true;
+        if (upload.geometry != nullptr) {
+            upload.geometry->resident = true;
+        }
+    }
+    vkEndCommandBuffer(mTransferCommandBuffer);
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &transferCommandBuffer;
+    submitInfo.pCommandBuffers = &mTransferCommandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &mTransferCompleteSemaphore;
 
-    if (vkQueueSubmit(mContext->getTransferQueue(), 1, &submitInfo, mTransferCompleteFences[imageIndex]) != VK_SUCCESS) {
+    if (vkQueueSubmit(mContext->getTransferQueue(), 1, &submitInfo, mTransferCompleteFence) != VK_SUCCESS) {
         throw std::runtime_error("Error, failed to submit transfer command");
     }
+    return true;
+}
+
+void MeshManager::growGeometryBuffers(VkCommandBuffer commandBuffer) {
+    /**
+     * Only happens when an arena doubles. The content is copied on the GPU and
+     * the offsets are kept, the previous buffers are released once the frames
+     * in flight no longer read them.
+     */
+    GeometryBuffers& buffers = mRenderData.geometryBuffers;
+    BufferPool& geometryPool = mContext->getMemoryManager().getBufferPool(BufferClass::Geometry);
+    bool copied{false};
+    if (buffers.vertexCapacity < mVertexArena.getCapacity()) {
+        BufferRange vertexBuffer = geometryPool.allocate(mVertexArena.getCapacity() * sizeof(Vertex));
+        if (buffers.vertexCapacity != 0) {
+            VkBufferCopy region{buffers.vertexBuffer.offset, vertexBuffer.offset, buffers.vertexCapacity * sizeof(Vertex)};
+            vkCmdCopyBuffer(commandBuffer, buffers.vertexBuffer.buffer, vertexBuffer.buffer, 1, &region);
+            copied = true;
+        }
+        geometryPool.free(buffers.vertexBuffer);
+        buffers.vertexBuffer = vertexBuffer;
+        buffers.vertexCapacity = mVertexArena.getCapacity();
+    }
+    if (buffers.indexCapacity < mIndexArena.getCapacity()) {
+        BufferRange indexBuffer = geometryPool.allocate(mIndexArena.getCapacity() * sizeof(uint32_t));
+        if (buffers.indexCapacity != 0) {
+            VkBufferCopy region{buffers.indexBuffer.offset, indexBuffer.offset, buffers.indexCapacity * sizeof(uint32_t)};
+            vkCmdCopyBuffer(commandBuffer, buffers.indexBuffer.buffer, indexBuffer.buffer, 1, &region);
+            copied = true;
+        }
+        geometryPool.free(buffers.indexBuffer);
+        buffers.indexBuffer = indexBuffer;
+        buffers.indexCapacity = mIndexArena.getCapacity();
+    }
+
+    /* The uploads recorded next overwrite parts of what has just been copied */
+    if (copied) {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+void MeshManager::createDescriptorSetLayout() {
+    /* Create the descriptor set layout */
+    VkDescriptorSetLayoutBinding bindings[2] = {};
 
-    mTemporaryStaticBuffers[imageIndex] = renderBuffer;
-    mShouldSwapBuffers[imageIndex] = true;
-}
\ No newline at end of file
+    /* Texture binding */
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    /* Model matrices binding, indexed by the instance index */
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    createInfo.bindingCount = 2;
+    createInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(mContext->getDevice(), &createInfo, nullptr, &mRenderData.descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout");
+    }
+}
+
+void MeshManager::allocateDescriptorSets() {
+    /* Without indirect draws, the instances are drawn with the descriptor set of their texture slot */
+    uint32_t count = MaximumMeshCount + (mIndirectDraw ? 0 : MaximumTextureCount);
+    std::vector<VkDescriptorSetLayout> layouts(count, mRenderData.descriptorSetLayout);
+
+    VkDescriptorSetAllocateInfo infos{};
+    infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    infos.descriptorPool = mContext->getDescriptorPool().getHandler();
+    infos.descriptorSetCount = count;
+    infos.pSetLayouts = layouts.data();
+
+    std::vector<VkDescriptorSet> descriptors(count, VK_NULL_HANDLE);
+
+    if (vkAllocateDescriptorSets(mContext->getDevice(), &infos, descriptors.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor sets");
+    }  
+
+    /* Copy to the mesh data pool */
+    for (size_t i{0};i < MaximumMeshCount;++i) {
+        mRenderData.meshDataPool[i].descriptorSet = descriptors[i];
+    }
+    for (size_t i{MaximumMeshCount};i < count;++i) {
+        mTextureSlots[i - MaximumMeshCount].descriptorSet = descriptors[i];
+    }
+}
+
+void MeshManager::updateDescriptorSet(Mesh& mesh, MeshData& meshData) {
+    writeDescriptorSet(meshData.descriptorSet, mesh.getTexture());
+    meshData.textureVersion = mesh.getTexture().getVersion();
+}
+
+void MeshManager::writeDescriptorSet(VkDescriptorSet descriptorSet, Texture& texture) {
+    /* Texture info */
+    VkDescriptorImageInfo info{};
+    info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    info.imageView = texture.getImageView().getHandler();
+    info.sampler = texture.getSampler().getHandler();
+
+    /* Model matrices info */
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = mContext->getMemoryManager().getFrameAllocator().getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(glm::mat4) * MaximumDrawDataCount;
+
+    VkWriteDescriptorSet writes[2] = {};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].dstBinding = 0;
+    writes[0].dstSet = descriptorSet;
+    writes[0].pImageInfo = &info;
+
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    writes[1].dstBinding = 1;
+    writes[1].dstSet = descriptorSet;
+    writes[1].pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(mContext->getDevice(), 2, writes, 0, nullptr);
+}
@@ -0,0 +1,76 @@
+#include "resources/ResidencyManager.hpp"
+
+#include <algorithm>
+
+void ResidencyManager::create(MemoryManager& memoryManager) {
+    mMemoryManager = &memoryManager;
+}
+
+void ResidencyManager::setImageCount(uint32_t count) {
+    mImageCount = count;
+}
+
+void ResidencyManager::beginFrame() {
+    mFrame++;
+}
+
+void ResidencyManager::add(Texture& texture, uint32_t heapIndex) {
+    /* Nothing samples it yet, so it is the cheapest one to evict */
+    Entry entry;
+    entry.position = mLeastRecentlyUsed.insert(mLeastRecentlyUsed.begin(), &texture);
+    entry.heapIndex = heapIndex;
+    mEntries[&texture] = entry;
+    mHeapTextureCounts[heapIndex]++;
+}
+
+void ResidencyManager::remove(Texture& texture) {
+    auto it = mEntries.find(&texture);
+    if (it == mEntries.end()) {
+        return;
+    }
+    mLeastRecentlyUsed.erase(it->second.position);
+    mHeapTextureCounts[it->second.heapIndex]--;
+    mEntries.erase(it);
+}
+
+void ResidencyManager::touch(Texture& texture) {
+    auto it = mEntries.find(&texture);
+    if (it == mEntries.end()) {
+        return;
+    }
+
+    Entry& entry = it->second;
+    if (entry.used && entry.lastUsedFrame == mFrame) {
+        return;
+    }
+    entry.used = true;
+    entry.lastUsedFrame = mFrame;
+    mLeastRecentlyUsed.splice(mLeastRecentlyUsed.end(), mLeastRecentlyUsed, entry.position);
+}
+
+bool ResidencyManager::isHeapUsed(uint32_t heapIndex) const {
+    return mHeapTextureCounts[heapIndex] != 0;
+}
+
+bool ResidencyManager::isOverBudget(uint32_t heapIndex, VkDeviceSize requestedSize, VkDeviceSize releasedSize) {
+    /* Evicted textures are only released once the current frame is over, count them as gone already */
+    MemoryHeapBudget heapBudget = mMemoryManager->getHeapBudget(heapIndex);
+    VkDeviceSize usage = heapBudget.usage - std::min(heapBudget.usage, releasedSize);
+    return usage + requestedSize > heapBudget.budget;
+}
+
+Texture* ResidencyManager::getEvictionCandidate(uint32_t heapIndex) const {
+    for (Texture* texture : mLeastRecentlyUsed) {
+        const Entry& entry = mEntries.at(texture);
+        if (entry.heapIndex != heapIndex) {
+            continue;
+        }
+
+        /* If the least recently used texture of the heap may still be sampled, all its others may too */
+        if (entry.used && entry.lastUsedFrame + mImageCount >= mFrame) {
+            return nullptr;
+        }
+        return texture;
+    }
+    return nullptr;
+}
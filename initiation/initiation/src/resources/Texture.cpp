@@ -24,3 +24,39 @@ void Texture::setSampler(Sampler sampler) {
 void Texture::setImage(Image image) {
     mImage = image;
 }
+
+const std::string& Texture::getFilename() const {
+    return mFilename;
+}
+
+void Texture::setFilename(std::string filename) {
+    mFilename = filename;
+}
+
+VkDeviceSize Texture::getSize() const {
+    return mSize;
+}
+
+void Texture::setSize(VkDeviceSize size) {
+    mSize = size;
+}
+
+bool Texture::isResident() const {
+    return mResident;
+}
+
+void Texture::setResident(bool resident) {
+    if (resident && !mResident) {
+        mVersion++;
+    }
+    mResident = resident;
+}
+
+uint32_t Texture::getVersion() const {
+    return mVersion;
+}
+
+void Texture::invalidate() {
+    /* The image has been replaced while resident, the descriptor sets pointing to it are written again */
+    mVersion++;
+}
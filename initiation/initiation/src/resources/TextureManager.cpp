@@ -12,38 +12,108 @@
 
 void TextureManager::create(VulkanContext& context) {
     mContext = &context;
+    mResidencyManager.create(mContext->getMemoryManager());
 }
 
 void TextureManager::destroy() {
     for (auto it{mTextures.begin()};it != mTextures.end();++it) {
-        it->second.getImageView().destroy(mContext->getDevice());
+        if (it->second.isResident()) {
+            it->second.getImageView().destroy(mContext->getDevice());
+            it->second.getImage().destroy(*mContext);
+        }
         it->second.getSampler().destroy(mContext->getDevice());
-        mContext->getMemoryManager().freeImage(it->second.getImage().getHandler());
     }
 }
 
 Texture& TextureManager::load(std::string name, std::string filename) {
-    Image image = _createImage(filename);
-    ImageView imageView = _createImageView(image);
-    Sampler sampler = _createSampler();
-
     Texture t;
-    t.setImage(image);
-    t.setImageView(imageView);
-    t.setSampler(sampler);
+    t.setFilename(filename);
+    t.setSampler(_createSampler());
 
     mTextures.insert(std::make_pair(name, std::move(t)));
 
-    return mTextures[name];
+    Texture& texture = mTextures[name];
+    makeResident(texture);
+    return texture;
 }
 
 Texture& TextureManager::getTexture(std::string name) {
     return mTextures.at(name);
 }
 
-VkBuffer TextureManager::_loadToStaging(std::string& filename,
-                                        uint32_t& width,
-                                        uint32_t& height) {
+void TextureManager::setImageCount(uint32_t count) {
+    mResidencyManager.setImageCount(count);
+}
+
+void TextureManager::beginFrame() {
+    mResidencyManager.beginFrame();
+    for (uint32_t i{0};i < VK_MAX_MEMORY_HEAPS;++i) {
+        if (mResidencyManager.isHeapUsed(i)) {
+            makeRoom(i, 0);
+        }
+    }
+}
+
+void TextureManager::use(Texture& texture) {
+    if (!texture.isResident()) {
+        makeResident(texture);
+    }
+    mResidencyManager.touch(texture);
+}
+
+void TextureManager::makeResident(Texture& texture) {
+    std::string filename = texture.getFilename();
+    Image image = _createImage(filename);
+    texture.setImage(image);
+    texture.setImageView(_createImageView(image));
+
+    MemoryManager& memoryManager = mContext->getMemoryManager();
+    AllocationHandle allocation = image.getAllocation();
+    texture.setSize(memoryManager.getAllocationSize(allocation));
+    texture.setResident(true);
+    mResidencyManager.add(texture, memoryManager.getHeapIndex(allocation));
+
+    memoryManager.setImageMovable(allocation, image.getInfo(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                  [this, &texture](VkImage, VkImage newImage) { move(texture, newImage); });
+}
+
+void TextureManager::evict(Texture& texture) {
+    mResidencyManager.remove(texture);
+
+    /* The image itself is released once the current frame is over, its view has to wait as well */
+    VkDevice device = mContext->getDevice();
+    ImageView imageView = texture.getImageView();
+    mContext->getMemoryManager().releaseDeferred([device, imageView]() mutable { imageView.destroy(device); });
+    texture.getImage().destroy(*mContext);
+    texture.setResident(false);
+}
+
+void TextureManager::move(Texture& texture, VkImage image) {
+    /* Frames in flight still sample the previous image through its view, the image itself is released by the defragmenter */
+    VkDevice device = mContext->getDevice();
+    ImageView imageView = texture.getImageView();
+    mContext->getMemoryManager().releaseDeferred([device, imageView]() mutable { imageView.destroy(device); });
+
+    texture.getImage().setHandler(image);
+    texture.setImageView(_createImageView(texture.getImage()));
+    texture.invalidate();
+}
+
+void TextureManager::makeRoom(uint32_t heapIndex, VkDeviceSize size) {
+    VkDeviceSize releasedSize{0};
+    while (mResidencyManager.isOverBudget(heapIndex, size, releasedSize)) {
+        Texture* texture = mResidencyManager.getEvictionCandidate(heapIndex);
+        if (texture == nullptr) {
+            return;
+        }
+        releasedSize += texture->getSize();
+        evict(*texture);
+    }
+}
+
+BufferRange TextureManager::_loadToStaging(std::string& filename,
+                                           uint32_t& width,
+                                           uint32_t& height) {
     int _width, _height, _bpp;
     uint8_t* pixels = stbi_load(filename.c_str(), &_width, &_height, &_bpp, 4);
 
@@ -51,25 +121,16 @@ VkBuffer TextureManager::_loadToStaging(std::string& filename,
     height = static_cast<uint32_t>(_height);
     
     VkDeviceSize size = width * height * 4;
-    VkBuffer stagingBuffer;
-    BufferHelper::createBuffer(*mContext, size,
-                               VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                               VK_SHARING_MODE_EXCLUSIVE,
-                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                               stagingBuffer, filename);
-
-    void* data;
-    mContext->getMemoryManager().mapMemory(stagingBuffer, size, &data);
-    memcpy(data, pixels, size);
-    mContext->getMemoryManager().unmapMemory(stagingBuffer);
+    BufferRange staging = mContext->getMemoryManager().getBufferPool(BufferClass::Staging).allocate(size);
+    memcpy(staging.data, pixels, size);
 
     stbi_image_free(pixels);
-    return stagingBuffer;
+    return staging;
 }
 
 Image TextureManager::_createImage(std::string& filename) {
     uint32_t width, height;
-    VkBuffer stagingBuffer = _loadToStaging(filename, width, height);
+    BufferRange staging = _loadToStaging(filename, width, height);
 
     Image image;
     image.setImageType(VK_IMAGE_TYPE_2D);
@@ -79,15 +140,13 @@ Image TextureManager::_createImage(std::string& filename) {
     image.setFormat(VK_FORMAT_R8G8B8A8_UNORM);
     image.setTiling(VK_IMAGE_TILING_OPTIMAL);
     image.setInitialLayout(VK_IMAGE_LAYOUT_UNDEFINED);
-    image.setUsage(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    /* Also a transfer source, so that the defragmenter can copy it elsewhere */
+    image.setUsage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
     image.setSharingMode(VK_SHARING_MODE_EXCLUSIVE);
     image.setSamples(VK_SAMPLE_COUNT_1_BIT);
     image.create(*mContext);
 
-    VkMemoryRequirements memoryRequirements;
-    vkGetImageMemoryRequirements(mContext->getDevice(), image.getHandler(), &memoryRequirements);
-
-    mContext->getMemoryManager().allocateForImage(image.getHandler(), memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, filename);
+    _allocateImage(image, filename);
 
     ImageHelper::transitionImageLayout(*mContext, image.getHandler(), VK_FORMAT_R8G8B8A8_UNORM,
                                  VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
@@ -95,17 +154,51 @@ Image TextureManager::_createImage(std::string& filename) {
 
     transferCommandPool.lock();
     BufferHelper::copyBufferToImage(*mContext, transferCommandPool,
-                                    mContext->getTransferQueue(), stagingBuffer,
+                                    mContext->getTransferQueue(), staging.buffer, staging.offset,
                                     image.getHandler(), width, height);
     transferCommandPool.unlock();
 
     ImageHelper::transitionImageLayout(*mContext, image.getHandler(), VK_FORMAT_R8G8B8A8_UNORM,
                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    mContext->getMemoryManager().freeBuffer(stagingBuffer);
+    mContext->getMemoryManager().getBufferPool(BufferClass::Staging).free(staging);
     return image;
 }
 
+void TextureManager::_allocateImage(Image& image, std::string& filename) {
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(mContext->getDevice(), image.getHandler(), &memoryRequirements);
+    /* The image lands in the heap of the best memory type unless that heap is exhausted */
+    uint32_t heapIndex = mContext->getMemoryManager().getPreferredHeapIndex(memoryRequirements.memoryTypeBits, MemoryUsage::GpuOnly);
+    makeRoom(heapIndex, memoryRequirements.size);
+
+    try {
+        image.setAllocation(mContext->getMemoryManager().allocateForImage(image.getHandler(), memoryRequirements,
+                                                                          MemoryUsage::GpuOnly, filename));
+        return;
+    } catch (const std::runtime_error&) {
+        /* The budget was not enough, evict as much as the image needs before stalling */
+        VkDeviceSize releasedSize{0};
+        while (releasedSize < memoryRequirements.size) {
+            Texture* texture = mResidencyManager.getEvictionCandidate(heapIndex);
+            if (texture == nullptr) {
+                break;
+            }
+            releasedSize += texture->getSize();
+            evict(*texture);
+        }
+        if (releasedSize == 0) {
+            throw;
+        }
+    }
+
+    /* Release the evicted textures right away, then give up if the room is still not enough */
+    vkDeviceWaitIdle(mContext->getDevice());
+    mContext->getMemoryManager().flushDeferredReleases();
+    image.setAllocation(mContext->getMemoryManager().allocateForImage(image.getHandler(), memoryRequirements,
+                                                                      MemoryUsage::GpuOnly, filename));
+}
+
 ImageView TextureManager::_createImageView(Image& image) {
     ImageView imageView;
     imageView.setImage(image.getHandler());
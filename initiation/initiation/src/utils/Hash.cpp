@@ -0,0 +1,88 @@
+#include "utils/Hash.hpp"
+
+#include <cstring>
+
+namespace {
+    constexpr uint64_t Prime1{0x9E3779B185EBCA87ull};
+    constexpr uint64_t Prime2{0xC2B2AE3D27D4EB4Full};
+    constexpr uint64_t Prime3{0x165667B19E3779F9ull};
+    constexpr uint64_t Prime4{0x85EBCA77C2B2AE63ull};
+    constexpr uint64_t Prime5{0x27D4EB2F165667C5ull};
+
+    inline uint64_t rotateLeft(uint64_t value, uint32_t count) {
+        return (value << count) | (value >> (64 - count));
+    }
+
+    /* Unaligned little endian reads, the streams are arrays of any type */
+    inline uint64_t read64(const uint8_t* data) {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t read32(const uint8_t* data) {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t accumulate(uint64_t accumulator, uint64_t input) {
+        accumulator += input * Prime2;
+        return rotateLeft(accumulator, 31) * Prime1;
+    }
+
+    inline uint64_t mergeRound(uint64_t hash, uint64_t accumulator) {
+        hash ^= accumulate(0, accumulator);
+        return hash * Prime1 + Prime4;
+    }
+}
+
+uint64_t Hash::xxHash64(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const uint8_t* end = bytes + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        /* Four independent lanes per 32 bytes stripe, the multiplications of a stripe overlap */
+        uint64_t accumulators[4] = {seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1};
+        const uint8_t* lastStripe = end - 32;
+        do {
+            for (size_t i{0};i < 4;++i) {
+                accumulators[i] = accumulate(accumulators[i], read64(bytes + i * 8));
+            }
+            bytes += 32;
+        } while (bytes <= lastStripe);
+
+        hash = rotateLeft(accumulators[0], 1) + rotateLeft(accumulators[1], 7) +
+               rotateLeft(accumulators[2], 12) + rotateLeft(accumulators[3], 18);
+        for (size_t i{0};i < 4;++i) {
+            hash = mergeRound(hash, accumulators[i]);
+        }
+    } else {
+        hash = seed + Prime5;
+    }
+    hash += static_cast<uint64_t>(size);
+
+    /* The tail, by 8, 4 then single bytes */
+    for (;bytes + 8 <= end;bytes += 8) {
+        hash ^= accumulate(0, read64(bytes));
+        hash = rotateLeft(hash, 27) * Prime1 + Prime4;
+    }
+    if (bytes + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(bytes)) * Prime1;
+        hash = rotateLeft(hash, 23) * Prime2 + Prime3;
+        bytes += 4;
+    }
+    for (;bytes < end;++bytes) {
+        hash ^= static_cast<uint64_t>(*bytes) * Prime5;
+        hash = rotateLeft(hash, 11) * Prime1;
+    }
+
+    /* Avalanche */
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -53,6 +53,10 @@ VkPhysicalDeviceLimits VulkanContext::getLimits() const {
     return mPhysicalDeviceLimits;
 }
 
+VkPhysicalDeviceFeatures VulkanContext::getEnabledFeatures() const {
+    return mEnabledFeatures;
+}
+
 VkQueue VulkanContext::getPresentQueue() const {
     return mPresentQueue;
 }
@@ -70,6 +74,8 @@ QueueFamilyIndices VulkanContext::getQueueFamilyIndices() const {
 }
 
 CommandPool& VulkanContext::getTransferCommandPool() {
+    /* Loader threads ask for their own pool concurrently */
+    std::lock_guard<std::mutex> lock(mTransferCommandPoolMutex);
     if (mTransferCommandPoolMap.find(std::this_thread::get_id()) == mTransferCommandPoolMap.end()) {
         CommandPool transferCommandPool;
         transferCommandPool.create(mDevice, mIndices.transferFamily.value());
@@ -172,6 +178,7 @@ void VulkanContext::createLogicalDevice() {
     std::set<uint32_t> uniqueQueueFamilies = {
         mIndices.graphicsFamily.value(),
         mIndices.presentFamily.value(),
+        mIndices.transferFamily.value(),
     };
 
     float queuePriority{1.0f};
@@ -184,9 +191,18 @@ void VulkanContext::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(mPhysicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    /* Needed by the indirect draw path only, the renderer falls back to one draw per mesh without them */
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+    mEnabledFeatures = deviceFeatures;
+
     VkDeviceCreateInfo deviceCreateInfo{};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -194,8 +210,31 @@ void VulkanContext::createLogicalDevice() {
 
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
-    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtension.size());
-    deviceCreateInfo.ppEnabledExtensionNames = deviceExtension.data();
+    std::vector<const char*> enabledExtensions = deviceExtension;
+    uint32_t optionalExtensionCount{0};
+    for (const char* extensionName : optionalDeviceExtension) {
+        if (checkDeviceExtensionSupport(extensionName)) {
+            enabledExtensions.push_back(extensionName);
+            optionalExtensionCount++;
+        }
+    }
+
+    /* The pooled geometry is written by the transfer queue while the graphics queue reads other ranges of it */
+    if (mIndices.transferFamily.value() != mIndices.graphicsFamily.value()) {
+        mMemoryManager.setSharedQueueFamilies({mIndices.graphicsFamily.value(), mIndices.transferFamily.value()});
+    }
+
+    /* Dedicated allocation hints need both optional extensions */
+    mMemoryManager.setDedicatedAllocationSupport(optionalExtensionCount == optionalDeviceExtension.size());
+
+    /* Without the budget extension, the memory manager falls back to a configured cap */
+    bool memoryBudgetSupported = mPhysicalDeviceProperties2Enabled && checkDeviceExtensionSupport(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memoryBudgetSupported) {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     if (enableValidationLayers) {
         deviceCreateInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -208,6 +247,11 @@ void VulkanContext::createLogicalDevice() {
         throw std::runtime_error("Failed to create logical device");
     }
 
+    if (memoryBudgetSupported) {
+        mMemoryManager.setMemoryBudgetSupport(reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+            vkGetInstanceProcAddr(mInstance, "vkGetPhysicalDeviceMemoryProperties2KHR")));
+    }
+
     vkGetDeviceQueue(mDevice, mIndices.presentFamily.value(), 0, &mPresentQueue);
     vkGetDeviceQueue(mDevice, mIndices.transferFamily.value(), 0, &mTransferQueue);
     vkGetDeviceQueue(mDevice, mIndices.graphicsFamily.value(), 0, &mGraphicsQueue);
@@ -238,6 +282,36 @@ bool VulkanContext::checkValidationLayerSupport() {
     return true;
 }
 
+bool VulkanContext::checkDeviceExtensionSupport(const char* extensionName) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    for (VkExtensionProperties& extension : availableExtensions) {
+        if (strcmp(extensionName, extension.extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VulkanContext::checkInstanceExtensionSupport(const char* extensionName) {
+    uint32_t extensionCount;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+    for (VkExtensionProperties& extension : availableExtensions) {
+        if (strcmp(extensionName, extension.extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 std::vector<const char*> VulkanContext::getRequiredExtensions() {
     uint32_t glfwExtensionCount{0};
     const char** glfwExtensions;
@@ -249,6 +323,12 @@ std::vector<const char*> VulkanContext::getRequiredExtensions() {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    /* Needed to query the memory budget */
+    mPhysicalDeviceProperties2Enabled = checkInstanceExtensionSupport(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    if (mPhysicalDeviceProperties2Enabled) {
+        extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
+
     return extensions;
 }
 
@@ -256,6 +336,7 @@ void VulkanContext::createDescriptorPool() {
     uint32_t maxDescriptorSetUniformBuffers = 10000;
     uint32_t maxDescriptorSetSampledImages = 10000;
     uint32_t maxDescriptorSetDynamicUniformBuffers = 10000;
+    uint32_t maxDescriptorSetDynamicStorageBuffers = 10000;
 
     std::vector<VkDescriptorPoolSize> poolSizes = {
         {
@@ -270,6 +351,10 @@ void VulkanContext::createDescriptorPool() {
             VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             maxDescriptorSetDynamicUniformBuffers
         },
+        {
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+            maxDescriptorSetDynamicStorageBuffers
+        },
     };
     mDescriptorPool.setPoolSizes(poolSizes);
     // TODO: remove this magical constant
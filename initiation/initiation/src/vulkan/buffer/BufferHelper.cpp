@@ -2,13 +2,13 @@
 
 #include "vulkan/Commands.hpp"
 
-void BufferHelper::createBuffer(VulkanContext& context,
-                                VkDeviceSize size,
-                                VkBufferUsageFlags usage,
-                                VkSharingMode sharingMode,
-                                VkMemoryPropertyFlags properties,
-                                VkBuffer& buffer,
-                                std::string name) {
+AllocationHandle BufferHelper::createBuffer(VulkanContext& context,
+                                            VkDeviceSize size,
+                                            VkBufferUsageFlags usage,
+                                            VkSharingMode sharingMode,
+                                            MemoryUsage memoryUsage,
+                                            VkBuffer& buffer,
+                                            std::string name) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
@@ -21,7 +21,8 @@ void BufferHelper::createBuffer(VulkanContext& context,
     VkMemoryRequirements memoryRequirements{};
     vkGetBufferMemoryRequirements(context.getDevice(), buffer, &memoryRequirements);
 
-    context.getMemoryManager().allocateForBuffer(buffer, memoryRequirements, properties, name);
+    /* The owner keeps the handle to free or map the buffer */
+    return context.getMemoryManager().allocateForBuffer(buffer, memoryRequirements, memoryUsage, name);
 }
 
 void BufferHelper::copyBuffer(VulkanContext& context,
@@ -66,13 +67,14 @@ void BufferHelper::copyBufferToImage(VulkanContext& context,
                                      CommandPool& commandPool,
                                      VkQueue queue,
                                      VkBuffer buffer,
+                                     VkDeviceSize bufferOffset,
                                      VkImage image,
                                      uint32_t width,
                                      uint32_t height) {
     VkCommandBuffer commandBuffer = Commands::beginSingleTime(context.getDevice(), commandPool);
 
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
 
@@ -17,7 +17,12 @@ void Image::create(VulkanContext& context) {
 
 void Image::destroy(VulkanContext& context) {
     if (mCreated) {
-        context.getMemoryManager().freeImage(mImage);
+        if (mAllocation.isValid()) {
+            context.getMemoryManager().freeAllocation(mAllocation);
+            mAllocation = AllocationHandle();
+        } else {
+            vkDestroyImage(context.getDevice(), mImage, nullptr);
+        }
         mCreated = false;
     }
 }
@@ -70,3 +75,19 @@ void Image::setFlags(VkFlags flags) {
 VkImage Image::getHandler() {
     return mImage;
 }
+
+void Image::setHandler(VkImage image) {
+    mImage = image;
+}
+
+const VkImageCreateInfo& Image::getInfo() const {
+    return mInfo;
+}
+
+void Image::setAllocation(AllocationHandle allocation) {
+    mAllocation = allocation;
+}
+
+AllocationHandle Image::getAllocation() const {
+    return mAllocation;
+}
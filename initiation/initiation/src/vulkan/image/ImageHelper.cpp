@@ -5,7 +5,8 @@
 VkImage ImageHelper::create(VulkanContext& context,
                    uint32_t width, uint32_t height,
                    VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                   VkMemoryPropertyFlags properties) {
+                   VkMemoryPropertyFlags properties,
+                   AllocationHandle& allocation) {
     VkImage image;
 
     VkImageCreateInfo imageInfo{};
@@ -31,7 +32,7 @@ VkImage ImageHelper::create(VulkanContext& context,
     VkMemoryRequirements memoryRequirements;
     vkGetImageMemoryRequirements(context.getDevice(), image, &memoryRequirements);
 
-    context.getMemoryManager().allocateForImage(image, memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "Image");
+    allocation = context.getMemoryManager().allocateForImage(image, memoryRequirements, MemoryUsage::GpuOnly, "Image", tiling);
     
     return image;
 }
@@ -21,22 +21,24 @@ layout(set = 1, binding = 0) uniform RenderInfo {
     vec4 lightPosition;
 } renderInfo;
 
-layout(set = 0, binding = 1) uniform ModelMatrix {
-    mat4 matrix;
-} model;
+/* The first instance of each draw is the index of its first matrix in this buffer */
+layout(std430, set = 0, binding = 1) readonly buffer ModelBuffer {
+    mat4 matrices[];
+} modelBuffer;
 
 out gl_PerVertex {
     vec4 gl_Position;
 };
 
 void main() {
-    gl_Position = renderInfo.proj * renderInfo.view * model.matrix * vec4(inPosition, 1.0);
+    mat4 model = modelBuffer.matrices[gl_InstanceIndex];
+    gl_Position = renderInfo.proj * renderInfo.view * model * vec4(inPosition, 1.0);
 
     outPosition = inPosition;
     outNormal = vec4(inNormal, 0.0);
     outColor = vec3(1.0);
     outTexCoord = inTexCoord;
     outLightPosition = renderInfo.lightPosition.xyz;
-    outModelMatrix = model.matrix;
+    outModelMatrix = model;
     outViewMatrix = renderInfo.view;
 }
\ No newline at end of file